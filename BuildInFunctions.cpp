@@ -1,164 +1,176 @@
 #include "BuildInFunctions.hpp"
 #include "Helper.hpp"
-
-RTResult NativePrintFunction::Execute(std::vector<std::variant<double, std::string, std::shared_ptr<FuncDefNode>, std::shared_ptr<List>, std::shared_ptr<BaseFunction>>> args)
+#include "Dict.hpp"
+#include "Iterator.hpp"
+#include "Parallel.hpp"
+#include "Runtime.hpp"
+#include "Task.hpp"
+#include "Channel.hpp"
+#include "Io.hpp"
+#include <thread>
+
+RTResult HigherOrderFunction::Execute(std::span<const SymbolValue>)
 {
-    RTResult res;
-
-    for (const auto& arg : args)
-    {
-        std::cout << Helper::Print(res.Success(arg));
-    }
-
-    return res.Success(std::nullopt);
+    return RTResult().Failure(std::make_unique<RuntimeError>(Position(), Position(), ToString() + " can only be called by the interpreter"));
 }
 
-RTResult NativePrintLnFunction::Execute(std::vector<std::variant<double, std::string, std::shared_ptr<FuncDefNode>, std::shared_ptr<List>, std::shared_ptr<BaseFunction>>> args)
+RTResult NativePrintFunction::Execute(std::span<const SymbolValue> args)
 {
-    RTResult res;
-
-    for (const auto& arg : args)
-    {
-        std::cout << Helper::Print(res.Success(arg));
-    }
+    runtime.Print(args, false);
+    return RTResult().Success(std::nullopt);
+}
 
-    std::cout << std::endl;
-    return res.Success(std::nullopt);
+RTResult NativePrintLnFunction::Execute(std::span<const SymbolValue> args)
+{
+    runtime.Print(args, true);
+    return RTResult().Success(std::nullopt);
 }
 
-RTResult NativeLengthFunction::Execute(std::vector<std::variant<double, std::string, std::shared_ptr<FuncDefNode>, std::shared_ptr<List>, std::shared_ptr<BaseFunction>>> args)
+RTResult NativeLengthFunction::Execute(std::span<const SymbolValue> args)
 {
     RTResult res;
 
-    if (args.size() != 1)
+    if (std::holds_alternative<std::string>(args[0]))
     {
-        return res.Failure(std::make_unique<RuntimeError>(Position(), Position(), "LENGTH() takes exactly 1 argument"));
+        return res.Success(std::make_optional(static_cast<int64_t>(std::get<std::string>(args[0]).length())));
     }
-
-    if (std::holds_alternative<std::string>(args[0]))
+    else if (std::holds_alternative<List*>(args[0]))
     {
-        return res.Success(std::make_optional(static_cast<double>(std::get<std::string>(args[0]).length())));
+        return res.Success(std::make_optional(static_cast<int64_t>(std::get<List*>(args[0])->elements.size())));
     }
-    else if (std::holds_alternative<std::shared_ptr<List>>(args[0]))
+    else if (std::holds_alternative<Dict*>(args[0]))
     {
-        return res.Success(std::make_optional(static_cast<double>(std::get<std::shared_ptr<List>>(args[0])->elements.size())));
+        return res.Success(std::make_optional(static_cast<int64_t>(std::get<Dict*>(args[0])->Count())));
     }
     else
     {
-        return res.Failure(std::make_unique<RuntimeError>(Position(), Position(), "LENGTH() argument must be a string or list"));
+        return res.Failure(std::make_unique<RuntimeError>(Position(), Position(), "LENGTH() argument must be a string, list or dictionary"));
     }
 }
 
-RTResult NativeInputStr::Execute(std::vector<std::variant<double, std::string, std::shared_ptr<FuncDefNode>, std::shared_ptr<List>, std::shared_ptr<BaseFunction>>> args)
+RTResult NativeInputStr::Execute(std::span<const SymbolValue> args)
 {
+    // A prompt printed before has to be visible while the user types
+    runtime.Flush();
+
     std::string text = "";
-    std::getline(std::cin, text);
+    runtime.GetScheduler().Block([&] { std::getline(runtime.Input(), text); });
     return RTResult().Success(text);
 }
 
-RTResult NativeInputNum::Execute(std::vector<std::variant<double, std::string, std::shared_ptr<FuncDefNode>, std::shared_ptr<List>, std::shared_ptr<BaseFunction>>> args)
+RTResult NativeInputNum::Execute(std::span<const SymbolValue> args)
 {
     std::string text = "";
-    double number = 0;
 
     while (true)
     {
-        std::getline(std::cin, text);
+        runtime.Flush();
+        runtime.GetScheduler().Block([&] { std::getline(runtime.Input(), text); });
         try
         {
-            number = std::stof(text);
-            break;
+            // Whole numbers stay integers, everything else is read as double
+            size_t parsed = 0;
+            int64_t integer = std::stoll(text, &parsed);
+            if (parsed == text.size())
+                return RTResult().Success(integer);
+
+            return RTResult().Success(std::stod(text));
         }
         catch (const std::exception& ex)
         {
-            std::cout << "'" << text << "' must be an number. Try again!" << std::endl;
+            runtime.Write("'" + text + "' must be an number. Try again!\n");
         }
     }
-
-    return RTResult().Success(number);
 }
 
-RTResult NativeClear::Execute(std::vector<std::variant<double, std::string, std::shared_ptr<FuncDefNode>, std::shared_ptr<List>, std::shared_ptr<BaseFunction>>> args)
+RTResult NativeClear::Execute(std::span<const SymbolValue> args)
 {
     RTResult res;
 
-    system("cls");
+    runtime.Flush();
+    runtime.GetScheduler().Block([] { system("cls"); });
 
     return res.Success(std::nullopt);
 }
 
-RTResult NativeIsNum::Execute(std::vector<std::variant<double, std::string, std::shared_ptr<FuncDefNode>, std::shared_ptr<List>, std::shared_ptr<BaseFunction>>> args)
+RTResult NativeIsNum::Execute(std::span<const SymbolValue> args)
 {
     RTResult res;
 
-    for (const auto& arg : args)
-    {
-        if (std::holds_alternative<double>(arg))
-            return res.Success(static_cast<double>(1));
-        else
-            return res.Success(static_cast<double>(0));
-    }
+    const auto& arg = args[0];
+    if (Helper::IsNumber(arg))
+        return res.Success(static_cast<int64_t>(1));
+    else
+        return res.Success(static_cast<int64_t>(0));
 }
 
-RTResult NativeIsStr::Execute(std::vector<std::variant<double, std::string, std::shared_ptr<FuncDefNode>, std::shared_ptr<List>, std::shared_ptr<BaseFunction>>> args)
+RTResult NativeIsStr::Execute(std::span<const SymbolValue> args)
 {
     RTResult res;
 
-    for (const auto& arg : args)
-    {
-        if (std::holds_alternative<std::string>(arg))
-            return res.Success(static_cast<double>(1));
-        else
-            return res.Success(static_cast<double>(0));
-    }
+    const auto& arg = args[0];
+    if (std::holds_alternative<std::string>(arg))
+        return res.Success(static_cast<int64_t>(1));
+    else
+        return res.Success(static_cast<int64_t>(0));
 }
 
-RTResult NativeIsList::Execute(std::vector<std::variant<double, std::string, std::shared_ptr<FuncDefNode>, std::shared_ptr<List>, std::shared_ptr<BaseFunction>>> args)
+RTResult NativeIsList::Execute(std::span<const SymbolValue> args)
 {
     RTResult res;
 
-    for (const auto& arg : args)
-    {
-        if (std::holds_alternative<std::shared_ptr<List>>(arg))
-            return res.Success(static_cast<double>(1));
-        else
-            return res.Success(static_cast<double>(0));
-    }
+    const auto& arg = args[0];
+    if (std::holds_alternative<List*>(arg))
+        return res.Success(static_cast<int64_t>(1));
+    else
+        return res.Success(static_cast<int64_t>(0));
 }
 
-RTResult NativeIsFunc::Execute(std::vector<std::variant<double, std::string, std::shared_ptr<FuncDefNode>, std::shared_ptr<List>, std::shared_ptr<BaseFunction>>> args)
+RTResult NativeIsDict::Execute(std::span<const SymbolValue> args)
 {
     RTResult res;
 
-    for (const auto& arg : args)
-    {
-        if (std::holds_alternative<std::shared_ptr<BaseFunction>>(arg) || std::holds_alternative<std::shared_ptr<FuncDefNode>>(arg))
-            return res.Success(static_cast<double>(1));
-        else
-            return res.Success(static_cast<double>(0));
-    }
+    const auto& arg = args[0];
+    if (std::holds_alternative<Dict*>(arg))
+        return res.Success(static_cast<int64_t>(1));
+    else
+        return res.Success(static_cast<int64_t>(0));
 }
 
-RTResult NativeAppend::Execute(std::vector<std::variant<double, std::string, std::shared_ptr<FuncDefNode>, std::shared_ptr<List>, std::shared_ptr<BaseFunction>>> args)
+RTResult NativeIsFunc::Execute(std::span<const SymbolValue> args)
 {
     RTResult res;
 
-    if (args.size() != 2)
-    {
-        return res.Failure(std::make_unique<RuntimeError>(Position(), Position(), "APPEND() takes exactly 2 arguments"));
-    }
+    const auto& arg = args[0];
+    if (std::holds_alternative<BaseFunction*>(arg) || std::holds_alternative<Function*>(arg))
+        return res.Success(static_cast<int64_t>(1));
+    else
+        return res.Success(static_cast<int64_t>(0));
+}
+
+// Calls of PARALLEL_MAP and PARALLEL_FOR run at the same time, each can only change what it created itself
+static RTResult SharedContainerError(const std::string& kind)
+{
+    return RTResult().Failure(std::make_unique<RuntimeError>(Position(), Position(), "A PARALLEL_MAP or PARALLEL_FOR call can only change " + kind + " it created"));
+}
+
+RTResult NativeAppend::Execute(std::span<const SymbolValue> args)
+{
+    RTResult res;
 
-    if (!std::holds_alternative<std::shared_ptr<List>>(args[0]))
+    if (!std::holds_alternative<List*>(args[0]))
     {
         return res.Failure(std::make_unique<RuntimeError>(Position(), Position(), "First argument must be a list"));
     }
 
-    auto list = std::get<std::shared_ptr<List>>(args[0]);
+    auto list = std::get<List*>(args[0]);
+    if (!Heap::MayChange(list))
+        return SharedContainerError("lists");
     list->elements.push_back(args[1]);
     return res.Success(std::nullopt);
 }
 
-RTResult NativePop::Execute(std::vector<std::variant<double, std::string, std::shared_ptr<FuncDefNode>, std::shared_ptr<List>, std::shared_ptr<BaseFunction>>> args)
+RTResult NativePop::Execute(std::span<const SymbolValue> args)
 {
     RTResult res;
 
@@ -167,21 +179,23 @@ RTResult NativePop::Execute(std::vector<std::variant<double, std::string, std::s
         return res.Failure(std::make_unique<RuntimeError>(Position(), Position(), "POP() takes 1 or 2 arguments"));
     }
 
-    if (!std::holds_alternative<std::shared_ptr<List>>(args[0]))
+    if (!std::holds_alternative<List*>(args[0]))
     {
         return res.Failure(std::make_unique<RuntimeError>(Position(), Position(), "First argument must be a list"));
     }
 
-    auto list = std::get<std::shared_ptr<List>>(args[0]);
-    double index = -1;
+    auto list = std::get<List*>(args[0]);
+    if (!Heap::MayChange(list))
+        return SharedContainerError("lists");
+    int64_t index = -1;
 
     if (args.size() == 2)
     {
-        if (!std::holds_alternative<double>(args[1]))
+        if (!Helper::IsNumber(args[1]))
         {
             return res.Failure(std::make_unique<RuntimeError>(Position(), Position(), "Second argument must be a number"));
         }
-        index = std::get<double>(args[1]);
+        index = Helper::ToInt(args[1]);
     }
 
     if (list->elements.empty())
@@ -189,7 +203,7 @@ RTResult NativePop::Execute(std::vector<std::variant<double, std::string, std::s
         return res.Failure(std::make_unique<RuntimeError>(Position(), Position(), "Cannot pop from empty list"));
     }
 
-    std::variant<double, std::string, std::shared_ptr<FuncDefNode>, std::shared_ptr<List>, std::shared_ptr<BaseFunction>> popped_value;
+    SymbolValue popped_value;
 
     if (index == -1)
     {
@@ -198,91 +212,81 @@ RTResult NativePop::Execute(std::vector<std::variant<double, std::string, std::s
     }
     else
     {
-        int idx = static_cast<int>(index);
-        if (idx < 0 || idx >= static_cast<int>(list->elements.size()))
+        if (index < 0 || index >= static_cast<int64_t>(list->elements.size()))
         {
             return res.Failure(std::make_unique<RuntimeError>(Position(), Position(), "Index out of bounds"));
         }
-        popped_value = list->elements[idx];
-        list->elements.erase(list->elements.begin() + idx);
+        popped_value = list->elements[index];
+        list->elements.erase(list->elements.begin() + index);
     }
 
     return res.Success(popped_value);
 }
 
-RTResult NativeExtend::Execute(std::vector<std::variant<double, std::string, std::shared_ptr<FuncDefNode>, std::shared_ptr<List>, std::shared_ptr<BaseFunction>>> args)
+RTResult NativeExtend::Execute(std::span<const SymbolValue> args)
 {
     RTResult res;
 
-    if (args.size() != 2)
-    {
-        return res.Failure(std::make_unique<RuntimeError>(Position(), Position(), "EXTEND() takes exactly 2 arguments"));
-    }
-
-    if (!std::holds_alternative<std::shared_ptr<List>>(args[0]))
+    if (!std::holds_alternative<List*>(args[0]))
     {
         return res.Failure(std::make_unique<RuntimeError>(Position(), Position(), "First argument must be a list"));
     }
 
-    if (!std::holds_alternative<std::shared_ptr<List>>(args[1]))
+    if (!std::holds_alternative<List*>(args[1]))
     {
         return res.Failure(std::make_unique<RuntimeError>(Position(), Position(), "Second argument must be a list"));
     }
 
-    auto listA = std::get<std::shared_ptr<List>>(args[0]);
-    auto listB = std::get<std::shared_ptr<List>>(args[1]);
+    auto listA = std::get<List*>(args[0]);
+    auto listB = std::get<List*>(args[1]);
+    if (!Heap::MayChange(listA))
+        return SharedContainerError("lists");
 
     listA->elements.insert(listA->elements.end(), listB->elements.begin(), listB->elements.end());
 
     return res.Success(std::nullopt);
 }
 
-RTResult NativeSystem::Execute(std::vector<std::variant<double, std::string, std::shared_ptr<FuncDefNode>, std::shared_ptr<List>, std::shared_ptr<BaseFunction>>> args)
+RTResult NativeSystem::Execute(std::span<const SymbolValue> args)
 {
     RTResult res;
 
-    if (args.size() != 1)
-    {
-        return res.Failure(std::make_unique<RuntimeError>(Position(), Position(), "SYSTEM() takes exactly 1 argument"));
-    }
-
     if (!std::holds_alternative<std::string>(args[0]))
     {
         return res.Failure(std::make_unique<RuntimeError>(Position(), Position(), "Argument must be a string"));
     }
 
-    system(std::get<std::string>(args[0]).c_str());
+    // The command writes to the same console, everything printed before has to come first
+    runtime.Flush();
+
+    // Other tasks run while the command does
+    runtime.GetScheduler().Block([&] { system(std::get<std::string>(args[0]).c_str()); });
 
     return res.Success(std::nullopt);
 }
 
-RTResult NativeRandom::Execute(std::vector<std::variant<double, std::string, std::shared_ptr<FuncDefNode>, std::shared_ptr<List>, std::shared_ptr<BaseFunction>>> args)
+RTResult NativeRandom::Execute(std::span<const SymbolValue> args)
 {
     RTResult res;
 
-    if (args.size() != 2)
-    {
-        return res.Failure(std::make_unique<RuntimeError>(Position(), Position(), "RANDOM() takes exactly 2 arguments"));
-    }
-
-    if (!std::holds_alternative<double>(args[0]))
+    if (!Helper::IsNumber(args[0]))
     {
         return res.Failure(std::make_unique<RuntimeError>(Position(), Position(), "First argument must be a number"));
     }
 
-    if (!std::holds_alternative<double>(args[1]))
+    if (!Helper::IsNumber(args[1]))
     {
         return res.Failure(std::make_unique<RuntimeError>(Position(), Position(), "Second argument must be a number"));
     }
 
-    int min = std::get<double>(args[0]);
-    int max = std::get<double>(args[1]);
-    int randVal = min + (std::rand() % (max - min + 1));
+    int64_t min = Helper::ToInt(args[0]);
+    int64_t max = Helper::ToInt(args[1]);
+    int64_t randVal = runtime.Random(min, max);
 
-    return res.Success(static_cast<double>(randVal));
+    return res.Success(randVal);
 }
 
-RTResult NativeRandomize::Execute(std::vector<std::variant<double, std::string, std::shared_ptr<FuncDefNode>, std::shared_ptr<List>, std::shared_ptr<BaseFunction>>> args)
+RTResult NativeRandomize::Execute(std::span<const SymbolValue> args)
 {
     RTResult res;
 
@@ -293,13 +297,480 @@ RTResult NativeRandomize::Execute(std::vector<std::variant<double, std::string,
 
     if (args.size() == 1)
     {
-        if (std::holds_alternative<double>(args[0]))
-            std::srand(static_cast<unsigned int>(std::get<double>(args[0])));
+        if (Helper::IsNumber(args[0]))
+            runtime.Seed(static_cast<uint64_t>(Helper::ToInt(args[0])));
         else
             return res.Failure(std::make_unique<RuntimeError>(Position(), Position(), "Seed must be a number"));
     }
     else
-        std::srand(static_cast<unsigned int>(std::time(nullptr)));
+        runtime.Seed(static_cast<uint64_t>(std::time(nullptr)));
 
     return res.Success(std::nullopt);
 }
+
+
+RTResult NativeInsert::Execute(std::span<const SymbolValue> args)
+{
+    RTResult res;
+
+    if (!std::holds_alternative<Dict*>(args[0]))
+    {
+        return res.Failure(std::make_unique<RuntimeError>(Position(), Position(), "First argument must be a dictionary"));
+    }
+
+    std::optional<DictKey> key = ToDictKey(args[1]);
+    if (!key.has_value())
+    {
+        return res.Failure(std::make_unique<RuntimeError>(Position(), Position(), "Key must be a number or string"));
+    }
+
+    if (!Heap::MayChange(std::get<Dict*>(args[0])))
+        return SharedContainerError("dictionaries");
+
+    std::get<Dict*>(args[0])->Insert(std::move(key.value()), args[2]);
+    return res.Success(std::nullopt);
+}
+
+RTResult NativeDelete::Execute(std::span<const SymbolValue> args)
+{
+    RTResult res;
+
+    if (!std::holds_alternative<Dict*>(args[0]))
+    {
+        return res.Failure(std::make_unique<RuntimeError>(Position(), Position(), "First argument must be a dictionary"));
+    }
+
+    if (!Heap::MayChange(std::get<Dict*>(args[0])))
+        return SharedContainerError("dictionaries");
+
+    std::optional<DictKey> key = ToDictKey(args[1]);
+    if (!key.has_value() || !std::get<Dict*>(args[0])->Erase(key.value()))
+    {
+        return res.Failure(std::make_unique<RuntimeError>(Position(), Position(), "Key not found in dictionary"));
+    }
+
+    return res.Success(std::nullopt);
+}
+
+RTResult NativeHasKey::Execute(std::span<const SymbolValue> args)
+{
+    RTResult res;
+
+    if (!std::holds_alternative<Dict*>(args[0]))
+    {
+        return res.Failure(std::make_unique<RuntimeError>(Position(), Position(), "First argument must be a dictionary"));
+    }
+
+    std::optional<DictKey> key = ToDictKey(args[1]);
+    bool found = key.has_value() && std::get<Dict*>(args[0])->Find(key.value()) != nullptr;
+    return res.Success(static_cast<int64_t>(found ? 1 : 0));
+}
+
+RTResult NativeKeys::Execute(std::span<const SymbolValue> args)
+{
+    RTResult res;
+
+    if (!std::holds_alternative<Dict*>(args[0]))
+    {
+        return res.Failure(std::make_unique<RuntimeError>(Position(), Position(), "Argument must be a dictionary"));
+    }
+
+    std::vector<ListValue> keys;
+    for (const auto& entry : std::get<Dict*>(args[0])->GetEntries())
+    {
+        if (!entry.erased)
+            keys.push_back(FromDictKey(entry.key));
+    }
+
+    return res.Success(heap.Allocate<List>(std::move(keys)));
+}
+
+RTResult NativeValues::Execute(std::span<const SymbolValue> args)
+{
+    RTResult res;
+
+    if (!std::holds_alternative<Dict*>(args[0]))
+    {
+        return res.Failure(std::make_unique<RuntimeError>(Position(), Position(), "Argument must be a dictionary"));
+    }
+
+    std::vector<ListValue> values;
+    for (const auto& entry : std::get<Dict*>(args[0])->GetEntries())
+    {
+        if (!entry.erased)
+            values.push_back(entry.value);
+    }
+
+    return res.Success(heap.Allocate<List>(std::move(values)));
+}
+
+RTResult NativeRange::Execute(std::span<const SymbolValue> args)
+{
+    RTResult res;
+
+    if (args.empty() || args.size() > 3)
+        return res.Failure(std::make_unique<RuntimeError>(Position(), Position(), "RANGE() takes 1 to 3 arguments"));
+
+    for (const auto& arg : args)
+    {
+        if (!Helper::IsNumber(arg))
+            return res.Failure(std::make_unique<RuntimeError>(Position(), Position(), "RANGE() arguments must be numbers"));
+    }
+
+    // RANGE(end) counts from 0, the step defaults to 1
+    SymbolValue start = args.size() >= 2 ? args[0] : SymbolValue(int64_t(0));
+    SymbolValue end = args.size() >= 2 ? args[1] : args[0];
+    SymbolValue step = args.size() == 3 ? args[2] : SymbolValue(int64_t(1));
+
+    if (Helper::ToDouble(step) == 0)
+        return res.Failure(std::make_unique<RuntimeError>(Position(), Position(), "RANGE() step must not be 0"));
+
+    // Like FOR, integer bounds count in integers and a single double makes it a double range
+    Iterator* range;
+    if (std::holds_alternative<int64_t>(start) && std::holds_alternative<int64_t>(end) && std::holds_alternative<int64_t>(step))
+        range = heap.Allocate<Range>(start, end, step);
+    else
+        range = heap.Allocate<Range>(Helper::ToDouble(start), Helper::ToDouble(end), Helper::ToDouble(step));
+
+    return res.Success(range);
+}
+
+RTResult NativeMemoize::Execute(std::span<const SymbolValue> args)
+{
+    RTResult res;
+
+    if (args.empty() || args.size() > 2)
+        return res.Failure(std::make_unique<RuntimeError>(Position(), Position(), "MEMOIZE() takes a function and optionally the maximum number of cached results"));
+
+    if (!std::holds_alternative<Function*>(args[0]) && !std::holds_alternative<BaseFunction*>(args[0]))
+        return res.Failure(std::make_unique<RuntimeError>(Position(), Position(), "First argument must be a function"));
+
+    size_t limit = 100000;
+    if (args.size() == 2)
+    {
+        if (!Helper::IsNumber(args[1]) || Helper::ToInt(args[1]) < 1)
+            return res.Failure(std::make_unique<RuntimeError>(Position(), Position(), "Second argument must be a positive number"));
+        limit = static_cast<size_t>(Helper::ToInt(args[1]));
+    }
+
+    BaseFunction* memoized = heap.Allocate<MemoizedFunction>(args[0], limit);
+    return res.Success(memoized);
+}
+
+// Arguments nested deeper or with a longer encoding are called through uncached. The depth also ends lists that
+// contain themselves (APPEND(a, a)), the size lists that contain the same list many times over
+constexpr size_t maxKeyDepth = 128;
+constexpr size_t maxKeySize = 1024 * 1024;
+
+// Appends a byte encoding of value to key, so equal argument values give equal keys. Returns false for values
+// that can't be compared by content
+static bool AppendKey(std::string& key, const SymbolValue& value, size_t depth = 0)
+{
+    auto appendRaw = [&key](const auto& raw) { key.append(reinterpret_cast<const char*>(&raw), sizeof(raw)); };
+
+    if (std::holds_alternative<int64_t>(value))
+    {
+        key += 'i';
+        appendRaw(std::get<int64_t>(value));
+    }
+    else if (std::holds_alternative<double>(value))
+    {
+        key += 'd';
+        appendRaw(std::get<double>(value));
+    }
+    else if (std::holds_alternative<std::string>(value))
+    {
+        const std::string& text = std::get<std::string>(value);
+        key += 's';
+        appendRaw(text.size());
+        key += text;
+    }
+    else if (std::holds_alternative<List*>(value))
+    {
+        if (depth >= maxKeyDepth)
+            return false;
+
+        const auto& elements = std::get<List*>(value)->elements;
+        key += 'l';
+        appendRaw(elements.size());
+        for (const auto& element : elements)
+        {
+            if (!AppendKey(key, element, depth + 1))
+                return false;
+        }
+    }
+    else
+        return false;
+
+    return key.size() <= maxKeySize;
+}
+
+RTResult MemoizedFunction::Call(Interpreter& interpreter, std::span<const SymbolValue> args)
+{
+    std::string key;
+    bool cacheable = true;
+    for (const auto& arg : args)
+    {
+        if (!AppendKey(key, arg))
+        {
+            cacheable = false;
+            break;
+        }
+    }
+
+    // The cache is shared, PARALLEL_MAP workers running at the same time call straight through
+    if (interpreter.IsWorker())
+        return interpreter.CallValue(function, args);
+
+    if (!cacheable)
+    {
+        misses++;
+        return interpreter.CallValue(function, args);
+    }
+
+    auto it = index.find(key);
+    if (it != index.end())
+    {
+        hits++;
+        entries.splice(entries.begin(), entries, it->second);
+        return RTResult().Success(it->second->value);
+    }
+
+    misses++;
+
+    // Recursive calls can fill the cache meanwhile, nothing of it is held across the call
+    RTResult result = interpreter.CallValue(function, args);
+    if (result.ShouldReturn())
+        return result;
+
+    it = index.find(key);
+    if (it != index.end())
+    {
+        it->second->value = result.GetValue();
+        return result;
+    }
+
+    entries.push_front(Entry{ std::move(key), result.GetValue() });
+    index.emplace(entries.front().key, entries.begin());
+
+    if (entries.size() > limit)
+    {
+        index.erase(entries.back().key);
+        entries.pop_back();
+    }
+
+    return result;
+}
+
+std::string MemoizedFunction::ToString() const
+{
+    return "<memoized " + Helper::Print(RTResult().Success(function)) + ">";
+}
+
+void MemoizedFunction::Trace(Heap& heap)
+{
+    heap.Mark(function);
+    for (const auto& entry : entries)
+    {
+        if (entry.value.has_value())
+            heap.Mark(entry.value.value());
+    }
+}
+
+RTResult NativeMemoStats::Execute(std::span<const SymbolValue> args)
+{
+    RTResult res;
+
+    auto memoized = std::holds_alternative<BaseFunction*>(args[0]) ? dynamic_cast<MemoizedFunction*>(std::get<BaseFunction*>(args[0])) : nullptr;
+    if (memoized == nullptr)
+        return res.Failure(std::make_unique<RuntimeError>(Position(), Position(), "Argument must be a function returned by MEMOIZE"));
+
+    Dict* stats = heap.Allocate<Dict>();
+    stats->Insert(std::string("hits"), static_cast<int64_t>(memoized->GetHits()));
+    stats->Insert(std::string("misses"), static_cast<int64_t>(memoized->GetMisses()));
+    stats->Insert(std::string("entries"), static_cast<int64_t>(memoized->GetCount()));
+    stats->Insert(std::string("limit"), static_cast<int64_t>(memoized->GetLimit()));
+    return res.Success(stats);
+}
+
+RTResult NativeChannel::Execute(std::span<const SymbolValue> args)
+{
+    RTResult res;
+
+    if (!std::holds_alternative<int64_t>(args[0]) || std::get<int64_t>(args[0]) < 1)
+        return res.Failure(std::make_unique<RuntimeError>(Position(), Position(), "Capacity must be a positive integer"));
+    if (static_cast<uint64_t>(std::get<int64_t>(args[0])) > Channel::maxCapacity)
+        return res.Failure(std::make_unique<RuntimeError>(Position(), Position(), "Capacity can be at most " + std::to_string(Channel::maxCapacity)));
+
+    Iterator* channel = runtime.GetHeap().Allocate<Channel>(runtime.GetScheduler(), static_cast<size_t>(std::get<int64_t>(args[0])));
+    return res.Success(channel);
+}
+
+static Channel* ToChannel(const SymbolValue& value)
+{
+    return std::holds_alternative<Iterator*>(value) ? dynamic_cast<Channel*>(std::get<Iterator*>(value)) : nullptr;
+}
+
+RTResult NativeSend::Execute(std::span<const SymbolValue> args)
+{
+    Channel* channel = ToChannel(args[0]);
+    if (channel == nullptr)
+        return RTResult().Failure(std::make_unique<RuntimeError>(Position(), Position(), "First argument must be a channel"));
+
+    return channel->Send(args[1]);
+}
+
+RTResult NativeRecv::Execute(std::span<const SymbolValue> args)
+{
+    Channel* channel = ToChannel(args[0]);
+    if (channel == nullptr)
+        return RTResult().Failure(std::make_unique<RuntimeError>(Position(), Position(), "Argument must be a channel"));
+
+    return channel->Receive();
+}
+
+RTResult NativeClose::Execute(std::span<const SymbolValue> args)
+{
+    Channel* channel = ToChannel(args[0]);
+    if (channel == nullptr)
+        return RTResult().Failure(std::make_unique<RuntimeError>(Position(), Position(), "Argument must be a channel"));
+
+    channel->Close();
+    return RTResult().Success(std::nullopt);
+}
+
+static RTResult StartRequest(Runtime& runtime, IoRequest::Operation operation)
+{
+    Handle* request = runtime.GetHeap().Allocate<IoRequest>(runtime.GetHeap(), runtime.GetScheduler(), std::move(operation));
+    return RTResult().Success(request);
+}
+
+RTResult NativeReadFile::Execute(std::span<const SymbolValue> args)
+{
+    if (!std::holds_alternative<std::string>(args[0]))
+        return RTResult().Failure(std::make_unique<RuntimeError>(Position(), Position(), "Argument must be a string"));
+
+    return StartRequest(runtime, IoRequest::ReadFile(std::get<std::string>(args[0])));
+}
+
+RTResult NativeWriteFile::Execute(std::span<const SymbolValue> args)
+{
+    if (!std::holds_alternative<std::string>(args[0]) || !std::holds_alternative<std::string>(args[1]))
+        return RTResult().Failure(std::make_unique<RuntimeError>(Position(), Position(), "Arguments must be strings"));
+
+    return StartRequest(runtime, IoRequest::WriteFile(std::get<std::string>(args[0]), std::get<std::string>(args[1])));
+}
+
+RTResult NativeRun::Execute(std::span<const SymbolValue> args)
+{
+    if (!std::holds_alternative<std::string>(args[0]))
+        return RTResult().Failure(std::make_unique<RuntimeError>(Position(), Position(), "Argument must be a string"));
+
+    return StartRequest(runtime, IoRequest::RunCommand(std::get<std::string>(args[0])));
+}
+
+RTResult NativeTimer::Execute(std::span<const SymbolValue> args)
+{
+    if (!Helper::IsNumber(args[0]) || Helper::ToInt(args[0]) < 0)
+        return RTResult().Failure(std::make_unique<RuntimeError>(Position(), Position(), "Argument must be a number that isn't negative"));
+
+    return StartRequest(runtime, IoRequest::Timer(Helper::ToInt(args[0])));
+}
+
+// Reads the optional worker count at args[at], the default is one worker per hardware thread
+static bool ParallelWorkers(std::span<const SymbolValue> args, size_t at, size_t& workers)
+{
+    workers = std::max(1u, std::thread::hardware_concurrency());
+    if (args.size() <= at)
+        return true;
+
+    if (!Helper::IsNumber(args[at]) || Helper::ToInt(args[at]) < 1)
+        return false;
+    workers = static_cast<size_t>(Helper::ToInt(args[at]));
+    return true;
+}
+
+static bool IsCallable(const SymbolValue& value)
+{
+    return std::holds_alternative<Function*>(value) || std::holds_alternative<BaseFunction*>(value);
+}
+
+RTResult NativeParallelMap::Call(Interpreter& interpreter, std::span<const SymbolValue> args)
+{
+    RTResult res;
+
+    if (args.size() < 2 || args.size() > 3)
+        return res.Failure(std::make_unique<RuntimeError>(Position(), Position(), "PARALLEL_MAP() takes a list, a function and optionally the number of workers"));
+
+    if (!std::holds_alternative<List*>(args[0]))
+        return res.Failure(std::make_unique<RuntimeError>(Position(), Position(), "First argument must be a list"));
+
+    if (!IsCallable(args[1]))
+        return res.Failure(std::make_unique<RuntimeError>(Position(), Position(), "Second argument must be a function"));
+
+    size_t workers;
+    if (!ParallelWorkers(args, 2, workers))
+        return res.Failure(std::make_unique<RuntimeError>(Position(), Position(), "Third argument must be a positive number"));
+
+    // Every worker writes only its own slots of results, nothing is collected before the last one finished
+    Heap& heap = interpreter.GetHeap();
+    std::vector<SymbolValue> elements(std::get<List*>(args[0])->elements);
+    std::vector<SymbolValue> results(elements.size(), int64_t(0));
+    GCRoot elementsRoot(heap, elements);
+    GCRoot resultsRoot(heap, results);
+
+    const SymbolValue& function = args[1];
+    RTResult result = ParallelFor(interpreter, elements.size(), workers, [&](Interpreter& worker, size_t i)
+    {
+        RTResult value = worker.CallValue(function, std::span<const SymbolValue>(&elements[i], 1));
+        if (value.HasError())
+            return value;
+
+        // Every element needs a result, a call without a value (a block FUNC that never RETURNs) is an error
+        if (!value.GetValue().has_value())
+            return RTResult().Failure(std::make_unique<RuntimeError>(Position(), Position(), "PARALLEL_MAP function returned no value for element " + std::to_string(i)));
+
+        results[i] = std::move(value.GetValue().value());
+        return RTResult().Success(std::nullopt);
+    });
+    if (result.HasError())
+        return result;
+
+    return res.Success(heap.Allocate<List>(std::move(results)));
+}
+
+RTResult NativeParallelFor::Call(Interpreter& interpreter, std::span<const SymbolValue> args)
+{
+    RTResult res;
+
+    if (args.size() < 3 || args.size() > 4)
+        return res.Failure(std::make_unique<RuntimeError>(Position(), Position(), "PARALLEL_FOR() takes a start, an end, a function and optionally the number of workers"));
+
+    if (!std::holds_alternative<int64_t>(args[0]) || !std::holds_alternative<int64_t>(args[1]))
+        return res.Failure(std::make_unique<RuntimeError>(Position(), Position(), "Start and end must be integers"));
+
+    if (!IsCallable(args[2]))
+        return res.Failure(std::make_unique<RuntimeError>(Position(), Position(), "Third argument must be a function"));
+
+    size_t workers;
+    if (!ParallelWorkers(args, 3, workers))
+        return res.Failure(std::make_unique<RuntimeError>(Position(), Position(), "Fourth argument must be a positive number"));
+
+    int64_t start = std::get<int64_t>(args[0]);
+    int64_t end = std::get<int64_t>(args[1]);
+    size_t count = end > start ? static_cast<size_t>(static_cast<uint64_t>(end) - static_cast<uint64_t>(start)) : 0;
+
+    const SymbolValue& function = args[2];
+    RTResult result = ParallelFor(interpreter, count, workers, [&](Interpreter& worker, size_t i)
+    {
+        SymbolValue index = static_cast<int64_t>(static_cast<uint64_t>(start) + i);
+        RTResult value = worker.CallValue(function, std::span<const SymbolValue>(&index, 1));
+        if (value.HasError())
+            return value;
+        return RTResult().Success(std::nullopt);
+    });
+    if (result.HasError())
+        return result;
+
+    return res.Success(std::nullopt);
+}
\ No newline at end of file
@@ -3,22 +3,102 @@
 #include <memory>
 #include <iostream>
 #include <variant>
-#include "Nodes.hpp"
+#include <span>
+#include <array>
+#include <list>
+#include <unordered_map>
+#include <string_view>
+#include "Heap.hpp"
 
-struct List;               // forward declare
 class RTResult;            // forward declare
+class Interpreter;
+class Runtime;
 
-class BaseFunction
+class BaseFunction : public GCObject
 {
 public:
+	BaseFunction(int arity = -1) : arity(arity) {}
 	virtual ~BaseFunction() = default;
-	virtual RTResult Execute(std::vector<std::variant<double, std::string, std::shared_ptr<FuncDefNode>, std::shared_ptr<List>, std::shared_ptr<BaseFunction>>> args) = 0;
+
+	// args is owned by the caller and only valid during the call, copy what has to outlive it
+	virtual RTResult Execute(std::span<const SymbolValue> args) = 0;
 	virtual std::string ToString() const = 0;
+
+	// Builtins with a fixed number of parameters pass it here, the interpreter checks it before the call,
+	// so Execute can use args directly. -1 means the builtin checks the count itself
+	int GetArity() const { return arity; }
+
+private:
+	int arity;
+};
+
+// Builtin that calls script functions. The interpreter calls Call with itself instead of Execute
+class HigherOrderFunction : public BaseFunction
+{
+public:
+	HigherOrderFunction(int arity = -1) : BaseFunction(arity) {}
+
+	virtual RTResult Call(Interpreter& interpreter, std::span<const SymbolValue> args) = 0;
+
+private:
+	RTResult Execute(std::span<const SymbolValue> args) override;
+};
+
+// Caller owned argument storage for builtin calls, the first few arguments are stored inline so common calls don't allocate
+class ArgBuffer : public RootProvider
+{
+public:
+	static constexpr size_t inlineCapacity = 4;
+
+	ArgBuffer(Heap& heap, size_t count) : heap(heap), isInline(count <= inlineCapacity)
+	{
+		if (!isInline)
+			overflowArgs.reserve(count);
+		heap.PushRoot(this);
+	}
+	ArgBuffer(const ArgBuffer&) = delete;
+	ArgBuffer& operator=(const ArgBuffer&) = delete;
+	~ArgBuffer() { heap.PopProviderRoot(); }
+
+	void Push(SymbolValue value)
+	{
+		if (isInline)
+			inlineArgs[count] = std::move(value);
+		else
+			overflowArgs.push_back(std::move(value));
+		count++;
+	}
+
+	std::span<const SymbolValue> Args() const
+	{
+		if (isInline)
+			return std::span<const SymbolValue>(inlineArgs.data(), count);
+		return overflowArgs;
+	}
+
+	void TraceRoots(Heap& heap) override
+	{
+		for (const auto& arg : Args())
+			heap.Mark(arg);
+	}
+
+private:
+	Heap& heap;
+	std::array<SymbolValue, inlineCapacity> inlineArgs;
+	std::vector<SymbolValue> overflowArgs;
+	size_t count = 0;
+	bool isInline;
 };
 
 class NativePrintFunction : public BaseFunction
 {
-	RTResult Execute(std::vector<std::variant<double, std::string, std::shared_ptr<FuncDefNode>, std::shared_ptr<List>, std::shared_ptr<BaseFunction>>> args) override;
+public:
+	NativePrintFunction(Runtime& runtime) : runtime(runtime) {}
+
+private:
+	Runtime& runtime;
+
+	RTResult Execute(std::span<const SymbolValue> args) override;
 	std::string ToString() const override
 	{
 		return "<built-in function 'PRINT'>";
@@ -27,7 +107,13 @@ class NativePrintFunction : public BaseFunction
 
 class NativePrintLnFunction : public BaseFunction
 {
-	RTResult Execute(std::vector<std::variant<double, std::string, std::shared_ptr<FuncDefNode>, std::shared_ptr<List>, std::shared_ptr<BaseFunction>>> args) override;
+public:
+	NativePrintLnFunction(Runtime& runtime) : runtime(runtime) {}
+
+private:
+	Runtime& runtime;
+
+	RTResult Execute(std::span<const SymbolValue> args) override;
 	std::string ToString() const override
 	{
 		return "<built-in function 'PRINTLN'>";
@@ -36,7 +122,11 @@ class NativePrintLnFunction : public BaseFunction
 
 class NativeLengthFunction : public BaseFunction
 {
-	RTResult Execute(std::vector<std::variant<double, std::string, std::shared_ptr<FuncDefNode>, std::shared_ptr<List>, std::shared_ptr<BaseFunction>>> args) override;
+public:
+	NativeLengthFunction() : BaseFunction(1) {}
+
+private:
+	RTResult Execute(std::span<const SymbolValue> args) override;
 	std::string ToString() const override
 	{
 		return "<built-in function 'LENGTH'>";
@@ -45,7 +135,13 @@ class NativeLengthFunction : public BaseFunction
 
 class NativeInputStr : public BaseFunction
 {
-	RTResult Execute(std::vector<std::variant<double, std::string, std::shared_ptr<FuncDefNode>, std::shared_ptr<List>, std::shared_ptr<BaseFunction>>> args) override;
+public:
+	NativeInputStr(Runtime& runtime) : runtime(runtime) {}
+
+private:
+	Runtime& runtime;
+
+	RTResult Execute(std::span<const SymbolValue> args) override;
 	std::string ToString() const override
 	{
 		return "<built-in function 'INPUT_STR'>";
@@ -54,7 +150,13 @@ class NativeInputStr : public BaseFunction
 
 class NativeInputNum : public BaseFunction
 {
-	RTResult Execute(std::vector<std::variant<double, std::string, std::shared_ptr<FuncDefNode>, std::shared_ptr<List>, std::shared_ptr<BaseFunction>>> args) override;
+public:
+	NativeInputNum(Runtime& runtime) : runtime(runtime) {}
+
+private:
+	Runtime& runtime;
+
+	RTResult Execute(std::span<const SymbolValue> args) override;
 	std::string ToString() const override
 	{
 		return "<built-in function 'INPUT_NUM'>";
@@ -63,7 +165,13 @@ class NativeInputNum : public BaseFunction
 
 class NativeClear : public BaseFunction
 {
-	RTResult Execute(std::vector<std::variant<double, std::string, std::shared_ptr<FuncDefNode>, std::shared_ptr<List>, std::shared_ptr<BaseFunction>>> args) override;
+public:
+	NativeClear(Runtime& runtime) : runtime(runtime) {}
+
+private:
+	Runtime& runtime;
+
+	RTResult Execute(std::span<const SymbolValue> args) override;
 	std::string ToString() const override
 	{
 		return "<built-in function 'CLEAR'>";
@@ -72,7 +180,11 @@ class NativeClear : public BaseFunction
 
 class NativeIsNum : public BaseFunction
 {
-	RTResult Execute(std::vector<std::variant<double, std::string, std::shared_ptr<FuncDefNode>, std::shared_ptr<List>, std::shared_ptr<BaseFunction>>> args) override;
+public:
+	NativeIsNum() : BaseFunction(1) {}
+
+private:
+	RTResult Execute(std::span<const SymbolValue> args) override;
 	std::string ToString() const override
 	{
 		return "<built-in function 'IS_NUM'>";
@@ -81,7 +193,11 @@ class NativeIsNum : public BaseFunction
 
 class NativeIsStr : public BaseFunction
 {
-	RTResult Execute(std::vector<std::variant<double, std::string, std::shared_ptr<FuncDefNode>, std::shared_ptr<List>, std::shared_ptr<BaseFunction>>> args) override;
+public:
+	NativeIsStr() : BaseFunction(1) {}
+
+private:
+	RTResult Execute(std::span<const SymbolValue> args) override;
 	std::string ToString() const override
 	{
 		return "<built-in function 'IS_STR'>";
@@ -90,16 +206,37 @@ class NativeIsStr : public BaseFunction
 
 class NativeIsList : public BaseFunction
 {
-	RTResult Execute(std::vector<std::variant<double, std::string, std::shared_ptr<FuncDefNode>, std::shared_ptr<List>, std::shared_ptr<BaseFunction>>> args) override;
+public:
+	NativeIsList() : BaseFunction(1) {}
+
+private:
+	RTResult Execute(std::span<const SymbolValue> args) override;
 	std::string ToString() const override
 	{
 		return "<built-in function 'IS_LIST'>";
 	}
 };
 
+class NativeIsDict : public BaseFunction
+{
+public:
+	NativeIsDict() : BaseFunction(1) {}
+
+private:
+	RTResult Execute(std::span<const SymbolValue> args) override;
+	std::string ToString() const override
+	{
+		return "<built-in function 'IS_DICT'>";
+	}
+};
+
 class NativeIsFunc : public BaseFunction
 {
-	RTResult Execute(std::vector<std::variant<double, std::string, std::shared_ptr<FuncDefNode>, std::shared_ptr<List>, std::shared_ptr<BaseFunction>>> args) override;
+public:
+	NativeIsFunc() : BaseFunction(1) {}
+
+private:
+	RTResult Execute(std::span<const SymbolValue> args) override;
 	std::string ToString() const override
 	{
 		return "<built-in function 'IS_Func'>";
@@ -108,7 +245,11 @@ class NativeIsFunc : public BaseFunction
 
 class NativeAppend : public BaseFunction
 {
-	RTResult Execute(std::vector<std::variant<double, std::string, std::shared_ptr<FuncDefNode>, std::shared_ptr<List>, std::shared_ptr<BaseFunction>>> args) override;
+public:
+	NativeAppend() : BaseFunction(2) {}
+
+private:
+	RTResult Execute(std::span<const SymbolValue> args) override;
 	std::string ToString() const override
 	{
 		return "<built-in function 'APPEND'>";
@@ -117,7 +258,7 @@ class NativeAppend : public BaseFunction
 
 class NativePop : public BaseFunction
 {
-	RTResult Execute(std::vector<std::variant<double, std::string, std::shared_ptr<FuncDefNode>, std::shared_ptr<List>, std::shared_ptr<BaseFunction>>> args) override;
+	RTResult Execute(std::span<const SymbolValue> args) override;
 	std::string ToString() const override
 	{
 		return "<built-in function 'POP'>";
@@ -126,7 +267,11 @@ class NativePop : public BaseFunction
 
 class NativeExtend : public BaseFunction
 {
-	RTResult Execute(std::vector<std::variant<double, std::string, std::shared_ptr<FuncDefNode>, std::shared_ptr<List>, std::shared_ptr<BaseFunction>>> args) override;
+public:
+	NativeExtend() : BaseFunction(2) {}
+
+private:
+	RTResult Execute(std::span<const SymbolValue> args) override;
 	std::string ToString() const override
 	{
 		return "<built-in function 'EXTEND'>";
@@ -135,7 +280,13 @@ class NativeExtend : public BaseFunction
 
 class NativeSystem : public BaseFunction
 {
-	RTResult Execute(std::vector<std::variant<double, std::string, std::shared_ptr<FuncDefNode>, std::shared_ptr<List>, std::shared_ptr<BaseFunction>>> args) override;
+public:
+	NativeSystem(Runtime& runtime) : BaseFunction(1), runtime(runtime) {}
+
+private:
+	Runtime& runtime;
+
+	RTResult Execute(std::span<const SymbolValue> args) override;
 	std::string ToString() const override
 	{
 		return "<built-in function 'SYSTEM'>";
@@ -144,7 +295,13 @@ class NativeSystem : public BaseFunction
 
 class NativeRandom : public BaseFunction
 {
-	RTResult Execute(std::vector<std::variant<double, std::string, std::shared_ptr<FuncDefNode>, std::shared_ptr<List>, std::shared_ptr<BaseFunction>>> args) override;
+public:
+	NativeRandom(Runtime& runtime) : BaseFunction(2), runtime(runtime) {}
+
+private:
+	Runtime& runtime;
+
+	RTResult Execute(std::span<const SymbolValue> args) override;
 	std::string ToString() const override
 	{
 		return "<built-in function 'RANDOM'>";
@@ -153,9 +310,301 @@ class NativeRandom : public BaseFunction
 
 class NativeRandomize : public BaseFunction
 {
-	RTResult Execute(std::vector<std::variant<double, std::string, std::shared_ptr<FuncDefNode>, std::shared_ptr<List>, std::shared_ptr<BaseFunction>>> args) override;
+public:
+	NativeRandomize(Runtime& runtime) : runtime(runtime) {}
+
+private:
+	Runtime& runtime;
+
+	RTResult Execute(std::span<const SymbolValue> args) override;
 	std::string ToString() const override
 	{
 		return "<built-in function 'RANDOMIZE'>";
 	}
+};
+
+class NativeInsert : public BaseFunction
+{
+public:
+	NativeInsert() : BaseFunction(3) {}
+
+private:
+	RTResult Execute(std::span<const SymbolValue> args) override;
+	std::string ToString() const override
+	{
+		return "<built-in function 'INSERT'>";
+	}
+};
+
+class NativeDelete : public BaseFunction
+{
+public:
+	NativeDelete() : BaseFunction(2) {}
+
+private:
+	RTResult Execute(std::span<const SymbolValue> args) override;
+	std::string ToString() const override
+	{
+		return "<built-in function 'DELETE'>";
+	}
+};
+
+class NativeHasKey : public BaseFunction
+{
+public:
+	NativeHasKey() : BaseFunction(2) {}
+
+private:
+	RTResult Execute(std::span<const SymbolValue> args) override;
+	std::string ToString() const override
+	{
+		return "<built-in function 'HAS_KEY'>";
+	}
+};
+
+class NativeKeys : public BaseFunction
+{
+public:
+	NativeKeys(Heap& heap) : BaseFunction(1), heap(heap) {}
+
+private:
+	Heap& heap;
+
+	RTResult Execute(std::span<const SymbolValue> args) override;
+	std::string ToString() const override
+	{
+		return "<built-in function 'KEYS'>";
+	}
+};
+
+class NativeValues : public BaseFunction
+{
+public:
+	NativeValues(Heap& heap) : BaseFunction(1), heap(heap) {}
+
+private:
+	Heap& heap;
+
+	RTResult Execute(std::span<const SymbolValue> args) override;
+	std::string ToString() const override
+	{
+		return "<built-in function 'VALUES'>";
+	}
+};
+
+class NativeRange : public BaseFunction
+{
+public:
+	NativeRange(Heap& heap) : heap(heap) {}
+
+private:
+	Heap& heap;
+
+	RTResult Execute(std::span<const SymbolValue> args) override;
+	std::string ToString() const override
+	{
+		return "<built-in function 'RANGE'>";
+	}
+};
+
+class NativeMemoize : public BaseFunction
+{
+public:
+	NativeMemoize(Heap& heap) : heap(heap) {}
+
+private:
+	Heap& heap;
+
+	RTResult Execute(std::span<const SymbolValue> args) override;
+	std::string ToString() const override
+	{
+		return "<built-in function 'MEMOIZE'>";
+	}
+};
+
+// Function returned by MEMOIZE. Results are cached by the values of the arguments (numbers, strings and the
+// contents of lists), the least recently used entry is dropped once the cache holds limit entries. Calls with
+// other arguments (dictionaries, functions) always go through to the function
+class MemoizedFunction : public HigherOrderFunction
+{
+public:
+	MemoizedFunction(SymbolValue function, size_t limit) : HigherOrderFunction(), function(std::move(function)), limit(limit) {}
+
+	RTResult Call(Interpreter& interpreter, std::span<const SymbolValue> args) override;
+	std::string ToString() const override;
+	void Trace(Heap& heap) override;
+	size_t Size() const override { return sizeof(MemoizedFunction) + entries.size() * (sizeof(Entry) + 2 * sizeof(void*) + sizeof(std::string_view)); }
+
+	size_t GetHits() const { return hits; }
+	size_t GetMisses() const { return misses; }
+	size_t GetCount() const { return entries.size(); }
+	size_t GetLimit() const { return limit; }
+
+private:
+	struct Entry
+	{
+		std::string key;
+		std::optional<SymbolValue> value;
+	};
+
+	SymbolValue function;
+	size_t limit;
+	std::list<Entry> entries;	// Most recently used first
+	std::unordered_map<std::string_view, std::list<Entry>::iterator> index;	// Keys point into entries
+	size_t hits = 0;
+	size_t misses = 0;
+};
+
+class NativeMemoStats : public BaseFunction
+{
+public:
+	NativeMemoStats(Heap& heap) : BaseFunction(1), heap(heap) {}
+
+private:
+	Heap& heap;
+
+	RTResult Execute(std::span<const SymbolValue> args) override;
+	std::string ToString() const override
+	{
+		return "<built-in function 'MEMO_STATS'>";
+	}
+};
+
+class NativeChannel : public BaseFunction
+{
+public:
+	NativeChannel(Runtime& runtime) : BaseFunction(1), runtime(runtime) {}
+
+private:
+	Runtime& runtime;
+
+	RTResult Execute(std::span<const SymbolValue> args) override;
+	std::string ToString() const override
+	{
+		return "<built-in function 'CHANNEL'>";
+	}
+};
+
+class NativeSend : public BaseFunction
+{
+public:
+	NativeSend() : BaseFunction(2) {}
+
+private:
+	RTResult Execute(std::span<const SymbolValue> args) override;
+	std::string ToString() const override
+	{
+		return "<built-in function 'SEND'>";
+	}
+};
+
+class NativeRecv : public BaseFunction
+{
+public:
+	NativeRecv() : BaseFunction(1) {}
+
+private:
+	RTResult Execute(std::span<const SymbolValue> args) override;
+	std::string ToString() const override
+	{
+		return "<built-in function 'RECV'>";
+	}
+};
+
+class NativeClose : public BaseFunction
+{
+public:
+	NativeClose() : BaseFunction(1) {}
+
+private:
+	RTResult Execute(std::span<const SymbolValue> args) override;
+	std::string ToString() const override
+	{
+		return "<built-in function 'CLOSE'>";
+	}
+};
+
+// READ_FILE(path), WRITE_FILE(path, text), RUN(command) and TIMER(milliseconds) start the operation and return a
+// request right away, AWAIT waits for it. Tasks and other requests keep going meanwhile
+class NativeReadFile : public BaseFunction
+{
+public:
+	NativeReadFile(Runtime& runtime) : BaseFunction(1), runtime(runtime) {}
+
+private:
+	Runtime& runtime;
+
+	RTResult Execute(std::span<const SymbolValue> args) override;
+	std::string ToString() const override
+	{
+		return "<built-in function 'READ_FILE'>";
+	}
+};
+
+class NativeWriteFile : public BaseFunction
+{
+public:
+	NativeWriteFile(Runtime& runtime) : BaseFunction(2), runtime(runtime) {}
+
+private:
+	Runtime& runtime;
+
+	RTResult Execute(std::span<const SymbolValue> args) override;
+	std::string ToString() const override
+	{
+		return "<built-in function 'WRITE_FILE'>";
+	}
+};
+
+class NativeRun : public BaseFunction
+{
+public:
+	NativeRun(Runtime& runtime) : BaseFunction(1), runtime(runtime) {}
+
+private:
+	Runtime& runtime;
+
+	RTResult Execute(std::span<const SymbolValue> args) override;
+	std::string ToString() const override
+	{
+		return "<built-in function 'RUN'>";
+	}
+};
+
+class NativeTimer : public BaseFunction
+{
+public:
+	NativeTimer(Runtime& runtime) : BaseFunction(1), runtime(runtime) {}
+
+private:
+	Runtime& runtime;
+
+	RTResult Execute(std::span<const SymbolValue> args) override;
+	std::string ToString() const override
+	{
+		return "<built-in function 'TIMER'>";
+	}
+};
+
+// PARALLEL_MAP(list, func[, workers]) and PARALLEL_FOR(start, end, func[, workers]) run func on several threads.
+// The workers share the heap and the globals, func may read globals but must not change lists or dictionaries
+// another call uses
+class NativeParallelMap : public HigherOrderFunction
+{
+public:
+	RTResult Call(Interpreter& interpreter, std::span<const SymbolValue> args) override;
+	std::string ToString() const override
+	{
+		return "<built-in function 'PARALLEL_MAP'>";
+	}
+};
+
+class NativeParallelFor : public HigherOrderFunction
+{
+public:
+	RTResult Call(Interpreter& interpreter, std::span<const SymbolValue> args) override;
+	std::string ToString() const override
+	{
+		return "<built-in function 'PARALLEL_FOR'>";
+	}
 };
\ No newline at end of file
@@ -0,0 +1,143 @@
+#include "Channel.hpp"
+
+Channel::Channel(Scheduler& scheduler, size_t capacity) : scheduler(scheduler), capacity(capacity), cells(std::make_unique<Cell[]>(capacity))
+{
+    for (size_t i = 0; i < capacity; i++)
+        cells[i].sequence.store(2 * i, std::memory_order_relaxed);
+}
+
+bool Channel::TryPush(const SymbolValue& value)
+{
+    size_t pos = enqueuePos.load(std::memory_order_relaxed);
+    while (true)
+    {
+        Cell& cell = cells[pos % capacity];
+        size_t sequence = cell.sequence.load(std::memory_order_acquire);
+        intptr_t diff = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(2 * pos);
+
+        // The cell is free for this position, claim it. Behind means the ring is full, ahead that another sender won
+        if (diff == 0)
+        {
+            if (enqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+            {
+                cell.value = value;
+                cell.sequence.store(2 * pos + 1, std::memory_order_release);
+                return true;
+            }
+        }
+        else if (diff < 0)
+            return false;
+        else
+            pos = enqueuePos.load(std::memory_order_relaxed);
+    }
+}
+
+bool Channel::TryPop(SymbolValue& value)
+{
+    size_t pos = dequeuePos.load(std::memory_order_relaxed);
+    while (true)
+    {
+        Cell& cell = cells[pos % capacity];
+        size_t sequence = cell.sequence.load(std::memory_order_acquire);
+        intptr_t diff = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(2 * pos + 1);
+
+        if (diff == 0)
+        {
+            if (dequeuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+            {
+                // The cell doesn't keep the value alive once it was received
+                value = std::move(cell.value);
+                cell.value = int64_t(0);
+                cell.sequence.store(2 * (pos + capacity), std::memory_order_release);
+                return true;
+            }
+        }
+        else if (diff < 0)
+            return false;
+        else
+            pos = dequeuePos.load(std::memory_order_relaxed);
+    }
+}
+
+bool Channel::Wait(WaitList& list, uint64_t seen)
+{
+    // Workers of PARALLEL_MAP can't park, they wait for the other workers to SEND or RECV
+    if (scheduler.IsExclusive())
+        return scheduler.Stall(seen);
+
+    return scheduler.Park(list);
+}
+
+static RTResult Deadlock(const Scheduler& scheduler)
+{
+    // Tasks don't run next to PARALLEL_MAP, its workers can only have waited for each other
+    std::string message = scheduler.IsExclusive() ? "Deadlock, every PARALLEL_MAP worker is waiting on a channel" : "Deadlock, every task is waiting";
+    return RTResult().Failure(std::make_unique<RuntimeError>(Position(), Position(), message));
+}
+
+RTResult Channel::Send(const SymbolValue& value)
+{
+    while (true)
+    {
+        if (closed)
+            return RTResult().Failure(std::make_unique<RuntimeError>(Position(), Position(), "Channel is closed"));
+
+        uint64_t seen = scheduler.Progress();
+        if (TryPush(value))
+        {
+            scheduler.WakeOne(receivers);
+            return RTResult().Success(std::nullopt);
+        }
+
+        if (!Wait(senders, seen))
+            return Deadlock(scheduler);
+    }
+}
+
+RTResult Channel::Next()
+{
+    SymbolValue value;
+    while (true)
+    {
+        uint64_t seen = scheduler.Progress();
+        if (TryPop(value))
+        {
+            scheduler.WakeOne(senders);
+            return RTResult().Success(value);
+        }
+
+        // Values sent before the close are still received, a send can have slipped in after the first try
+        if (closed)
+        {
+            if (!TryPop(value))
+                return RTResult().Success(std::nullopt);
+
+            scheduler.WakeOne(senders);
+            return RTResult().Success(value);
+        }
+
+        if (!Wait(receivers, seen))
+            return Deadlock(scheduler);
+    }
+}
+
+RTResult Channel::Receive()
+{
+    RTResult result = Next();
+    if (!result.HasError() && !result.GetValue().has_value())
+        return RTResult().Failure(std::make_unique<RuntimeError>(Position(), Position(), "Channel is closed"));
+    return result;
+}
+
+void Channel::Close()
+{
+    closed = true;
+    scheduler.WakeAll(senders);
+    scheduler.WakeAll(receivers);
+}
+
+void Channel::Trace(Heap& heap)
+{
+    for (size_t i = 0; i < capacity; i++)
+        heap.Mark(cells[i].value);
+}
\ No newline at end of file
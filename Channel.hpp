@@ -0,0 +1,50 @@
+#pragma once
+#include <atomic>
+#include <memory>
+#include "Iterator.hpp"
+#include "Task.hpp"
+
+// Bounded queue between tasks, CHANNEL(capacity). A ring of cells with a sequence number each (Vyukov's MPMC
+// queue), so PARALLEL_MAP workers can SEND and RECV at the same time without a lock. A full SEND parks the task
+// until a value was received, an empty RECV until one was sent. FOR x IN channel receives until it is closed and
+// empty
+class Channel : public Iterator
+{
+public:
+	// Every cell is allocated up front, larger capacities are an error instead of exhausting memory
+	static constexpr size_t maxCapacity = 1024 * 1024;
+
+	Channel(Scheduler& scheduler, size_t capacity);
+
+	RTResult Send(const SymbolValue& value);
+	// Same as Next, but receiving from a closed and empty channel is an error
+	RTResult Receive();
+	void Close();
+
+	RTResult Next() override;
+	std::string ToString() const override { return "<channel>"; }
+	void Trace(Heap& heap) override;
+	size_t Size() const override { return sizeof(Channel) + capacity * sizeof(Cell); }
+
+private:
+	struct Cell
+	{
+		// 2 * position while free for that position, 2 * position + 1 once it holds its value. Without the
+		// factor a full cell of a ring of one would look free for the next position
+		std::atomic<size_t> sequence;
+		SymbolValue value;
+	};
+
+	Scheduler& scheduler;
+	size_t capacity;
+	std::unique_ptr<Cell[]> cells;
+	std::atomic<size_t> enqueuePos = 0;
+	std::atomic<size_t> dequeuePos = 0;
+	std::atomic<bool> closed = false;
+	WaitList senders;
+	WaitList receivers;
+
+	bool TryPush(const SymbolValue& value);
+	bool TryPop(SymbolValue& value);
+	bool Wait(WaitList& list, uint64_t seen);
+};
\ No newline at end of file
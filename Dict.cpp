@@ -0,0 +1,220 @@
+#include "Dict.hpp"
+#include <bit>
+#include <cmath>
+#include <cstring>
+#include <functional>
+
+std::optional<DictKey> ToDictKey(const SymbolValue& value)
+{
+    if (std::holds_alternative<int64_t>(value))
+        return std::get<int64_t>(value);
+    if (std::holds_alternative<std::string>(value))
+        return std::get<std::string>(value);
+    if (std::holds_alternative<double>(value))
+    {
+        double number = std::get<double>(value);
+        if (std::isnan(number))
+            return std::nullopt;
+        if (number == std::trunc(number) && number >= -9223372036854775808.0 && number < 9223372036854775808.0)
+            return static_cast<int64_t>(number);
+        return number;
+    }
+
+    return std::nullopt;
+}
+
+SymbolValue FromDictKey(const DictKey& key)
+{
+    if (std::holds_alternative<int64_t>(key))
+        return std::get<int64_t>(key);
+    if (std::holds_alternative<double>(key))
+        return std::get<double>(key);
+    return std::get<std::string>(key);
+}
+
+namespace
+{
+    constexpr uint64_t lsbs = 0x0101010101010101ULL;
+    constexpr uint64_t msbs = 0x8080808080808080ULL;
+
+    uint64_t Mix(uint64_t x)
+    {
+        x ^= x >> 33;
+        x *= 0xff51afd7ed558ccdULL;
+        x ^= x >> 33;
+        x *= 0xc4ceb9fe1a85ec53ULL;
+        x ^= x >> 33;
+        return x;
+    }
+
+    // Control bytes of a group, byte i of the result is slot i (the bit tricks below assume little endian)
+    uint64_t LoadGroup(const int8_t* ctrl)
+    {
+        uint64_t group;
+        std::memcpy(&group, ctrl, sizeof(group));
+        return group;
+    }
+
+    // High bit set for every byte equal to h2, can report false positives next to a real match
+    uint64_t MatchByte(uint64_t group, uint8_t h2)
+    {
+        uint64_t x = group ^ (lsbs * h2);
+        return (x - lsbs) & ~x & msbs;
+    }
+
+    uint64_t MatchEmpty(uint64_t group)
+    {
+        return group & ~(group << 6) & msbs;
+    }
+
+    uint64_t MatchEmptyOrDeleted(uint64_t group)
+    {
+        return group & ~(group << 7) & msbs;
+    }
+}
+
+uint64_t Dict::Hash(const DictKey& key)
+{
+    if (std::holds_alternative<int64_t>(key))
+        return Mix(static_cast<uint64_t>(std::get<int64_t>(key)));
+    if (std::holds_alternative<double>(key))
+        return Mix(std::bit_cast<uint64_t>(std::get<double>(key)) ^ 0x9e3779b97f4a7c15ULL);
+    return Mix(std::hash<std::string>{}(std::get<std::string>(key)));
+}
+
+size_t Dict::FindSlot(const DictKey& key, uint64_t hash) const
+{
+    if (ctrl.empty())
+        return SIZE_MAX;
+
+    const int8_t h2 = static_cast<int8_t>(hash & 0x7F);
+    const size_t groupMask = ctrl.size() / groupWidth - 1;
+    size_t group = (hash >> 7) & groupMask;
+
+    // Triangular probing visits every group once, because the group count is a power of two
+    for (size_t step = 1; ; ++step)
+    {
+        uint64_t word = LoadGroup(&ctrl[group * groupWidth]);
+        for (uint64_t mask = MatchByte(word, static_cast<uint8_t>(h2)); mask != 0; mask &= mask - 1)
+        {
+            size_t slot = group * groupWidth + std::countr_zero(mask) / 8;
+            if (ctrl[slot] == h2 && entries[slots[slot]].key == key)
+                return slot;
+        }
+
+        if (MatchEmpty(word) != 0)
+            return SIZE_MAX;
+
+        group = (group + step) & groupMask;
+    }
+}
+
+size_t Dict::FindInsertSlot(uint64_t hash) const
+{
+    const size_t groupMask = ctrl.size() / groupWidth - 1;
+    size_t group = (hash >> 7) & groupMask;
+
+    for (size_t step = 1; ; ++step)
+    {
+        uint64_t mask = MatchEmptyOrDeleted(LoadGroup(&ctrl[group * groupWidth]));
+        if (mask != 0)
+            return group * groupWidth + std::countr_zero(mask) / 8;
+
+        group = (group + step) & groupMask;
+    }
+}
+
+void Dict::Rehash(size_t minCount)
+{
+    // Drop erased entries, so the entry vector doesn't grow forever with insert/erase cycles
+    std::vector<Entry> live;
+    live.reserve(std::max(minCount, count));
+    for (auto& entry : entries)
+    {
+        if (!entry.erased)
+            live.push_back(std::move(entry));
+    }
+    if (live.size() != entries.size())
+        layout++;
+    entries = std::move(live);
+
+    size_t capacity = groupWidth;
+    while (capacity * 7 / 8 < minCount * 2)
+        capacity *= 2;
+
+    ctrl.assign(capacity, ctrlEmpty);
+    slots.assign(capacity, 0);
+
+    for (size_t i = 0; i < entries.size(); ++i)
+    {
+        uint64_t hash = Hash(entries[i].key);
+        size_t slot = FindInsertSlot(hash);
+        ctrl[slot] = static_cast<int8_t>(hash & 0x7F);
+        slots[slot] = static_cast<uint32_t>(i);
+    }
+
+    growthLeft = capacity * 7 / 8 - entries.size();
+}
+
+SymbolValue* Dict::Find(const DictKey& key)
+{
+    size_t slot = FindSlot(key, Hash(key));
+    if (slot == SIZE_MAX)
+        return nullptr;
+
+    return &entries[slots[slot]].value;
+}
+
+bool Dict::Insert(DictKey key, SymbolValue value)
+{
+    uint64_t hash = Hash(key);
+    size_t slot = FindSlot(key, hash);
+    if (slot != SIZE_MAX)
+    {
+        entries[slots[slot]].value = std::move(value);
+        return false;
+    }
+
+    if (growthLeft == 0 || (entries.size() == entries.capacity() && entries.size() > count * 2))
+        Rehash(count + 1);
+
+    slot = FindInsertSlot(hash);
+    if (ctrl[slot] == ctrlEmpty)
+        growthLeft--;
+
+    ctrl[slot] = static_cast<int8_t>(hash & 0x7F);
+    slots[slot] = static_cast<uint32_t>(entries.size());
+    entries.push_back(Entry{ std::move(key), std::move(value) });
+    count++;
+    return true;
+}
+
+bool Dict::Erase(const DictKey& key)
+{
+    size_t slot = FindSlot(key, Hash(key));
+    if (slot == SIZE_MAX)
+        return false;
+
+    Entry& entry = entries[slots[slot]];
+    entry.erased = true;
+    entry.key = int64_t(0);
+    entry.value = int64_t(0);
+
+    ctrl[slot] = ctrlDeleted;
+    count--;
+    return true;
+}
+
+void Dict::Trace(Heap& heap)
+{
+    for (const auto& entry : entries)
+    {
+        if (!entry.erased)
+            heap.Mark(entry.value);
+    }
+}
+
+size_t Dict::Size() const
+{
+    return sizeof(Dict) + entries.capacity() * sizeof(Entry) + ctrl.capacity() + slots.capacity() * sizeof(uint32_t);
+}
\ No newline at end of file
@@ -0,0 +1,59 @@
+#pragma once
+#include <vector>
+#include <string>
+#include <variant>
+#include <optional>
+#include <cstdint>
+#include "Heap.hpp"
+
+// Numbers and strings can be used as keys. Whole doubles are stored as integers, so 1 and 1.0 are the same key
+using DictKey = std::variant<int64_t, double, std::string>;
+
+std::optional<DictKey> ToDictKey(const SymbolValue& value);
+SymbolValue FromDictKey(const DictKey& key);
+
+// Open addressing hash map in the style of a swiss table: one control byte per slot holds 7 bits of the hash,
+// so a probe checks 8 slots at once without touching the keys. Entries live in a separate dense vector in
+// insertion order, which keeps iteration cheap and the printed order stable.
+struct Dict : public GCObject
+{
+	struct Entry
+	{
+		DictKey key;
+		SymbolValue value;
+		bool erased = false;
+	};
+
+	Dict() = default;
+
+	SymbolValue* Find(const DictKey& key);
+	// Returns false if the key already existed and only the value was replaced
+	bool Insert(DictKey key, SymbolValue value);
+	bool Erase(const DictKey& key);
+
+	size_t Count() const { return count; }
+	const std::vector<Entry>& GetEntries() const { return entries; }
+	// Changes whenever a rehash dropped erased entries and so moved the others, positions into the entries from
+	// before are meaningless then
+	uint64_t GetLayout() const { return layout; }
+
+	void Trace(Heap& heap) override;
+	size_t Size() const override;
+
+private:
+	static constexpr size_t groupWidth = 8;
+	static constexpr int8_t ctrlEmpty = -128;
+	static constexpr int8_t ctrlDeleted = -2;
+
+	std::vector<int8_t> ctrl;
+	std::vector<uint32_t> slots;	// Index into entries for every full control byte
+	std::vector<Entry> entries;
+	size_t count = 0;
+	size_t growthLeft = 0;
+	uint64_t layout = 0;
+
+	static uint64_t Hash(const DictKey& key);
+	size_t FindSlot(const DictKey& key, uint64_t hash) const;
+	size_t FindInsertSlot(uint64_t hash) const;
+	void Rehash(size_t minCapacity);
+};
\ No newline at end of file
@@ -1,35 +1,13 @@
 #include <iostream>
-#include "Lexer.hpp"
 #include "Helper.hpp"
 #include <string>
-#include "Parser.hpp"
-#include "Interpreter.hpp"
+#include "Runtime.hpp"
 #include <fstream>
 #include <filesystem>
 
 int main(int argc, char** argv)
 {
-    SymbolTable globalSymbolTable = SymbolTable();
-    globalSymbolTable.Set("NULL", static_cast<double>(0));
-    globalSymbolTable.Set("TRUE", static_cast<double>(1));
-    globalSymbolTable.Set("FALSE", static_cast<double>(0));
-    globalSymbolTable.Set("MATH_PI", static_cast<double>(3.141592653589793));
-    globalSymbolTable.Set("PRINT", std::make_shared<NativePrintFunction>());
-    globalSymbolTable.Set("PRINTLN", std::make_shared<NativePrintLnFunction>());
-    globalSymbolTable.Set("LENGTH", std::make_shared<NativeLengthFunction>());
-    globalSymbolTable.Set("INPUT_STR", std::make_shared<NativeInputStr>());
-    globalSymbolTable.Set("INPUT_NUM", std::make_shared<NativeInputNum>());
-    globalSymbolTable.Set("IS_NUM", std::make_shared<NativeIsNum>());
-    globalSymbolTable.Set("IS_STR", std::make_shared<NativeIsStr>());
-    globalSymbolTable.Set("IS_LIST", std::make_shared<NativeIsList>());
-    globalSymbolTable.Set("IS_FUNC", std::make_shared<NativeIsFunc>());
-    globalSymbolTable.Set("APPEND", std::make_shared<NativeAppend>());
-    globalSymbolTable.Set("POP", std::make_shared<NativePop>());
-    globalSymbolTable.Set("EXTEND", std::make_shared<NativeExtend>());
-    globalSymbolTable.Set("CLEAR", std::make_shared<NativeClear>());
-    globalSymbolTable.Set("SYSTEM", std::make_shared<NativeSystem>());
-    globalSymbolTable.Set("RANDOM", std::make_shared<NativeRandom>());
-    globalSymbolTable.Set("RANDOMIZE", std::make_shared<NativeRandomize>());
+    Runtime runtime;
 
     std::string text;
     bool loadedFromFile = false;
@@ -56,6 +34,9 @@ int main(int argc, char** argv)
         }
     }
 
+    // Typed lines show their output right away, a file writes it in large blocks
+    runtime.SetLineBuffered(!loadedFromFile || Helper::argv_has(argc, argv, "--line-buffered"));
+
     while (true)
     {
         if (!loadedFromFile)
@@ -70,77 +51,9 @@ int main(int argc, char** argv)
         if (trimText.empty())
             continue;
 
-        // Generate tokens
-        Lexer lexer(loadedFromFile ? std::filesystem::path(argv[1]).filename().string() : "<stdin>", text);
-        MakeTokensResult tokenResult = lexer.MakeTokens();
-
-        if (tokenResult.error != nullptr)
-        {
-            std::cout << tokenResult.error->AsString() << std::endl;
-
-            if (!loadedFromFile)
-                continue;
-            else
-                break;
-        }
-
-        // Print tokenResult
-        if (Helper::argv_has(argc, argv, "--tokens"))
-            std::cout << "Token result: " << Helper::TokenVectorToString(tokenResult.tokens) << std::endl;
-
-        // Generate AST
-        Parser parser(tokenResult.tokens);
-        ParseResult ast = parser.Parse();
-
-        if (ast.HasError())
-        {
-            std::cout << ast.GetError() << std::endl;
-
-            if (!loadedFromFile)
-                continue;
-            else
-                break;
-        }
-            
-        // Print ast
-        if (Helper::argv_has(argc, argv, "--ast"))
-            std::cout << "AST: " << ast.GetNode()->Repr() << std::endl;
-
-        Interpreter interpreter(globalSymbolTable);
-        interpreter.SetMainFilePath(loadedFromFile ? argv[1] : std::filesystem::current_path().string());
-        auto result = interpreter.Visit(ast.GetNode());
-
-        if (result.HasError())
-        {
-            std::cout << result.GetError() << std::endl;
-
-            if (!loadedFromFile)
-                continue;
-            else
-                break;
-        }
-
-        // Print result
-        if (result.GetValue().has_value())
-        {
-            if (!loadedFromFile)
-                std::cout << Helper::Print(result) << std::endl;
-            else // Because when reading from file everything is inputted as on giant block, so every result in it is in another list
-            {
-                if (std::holds_alternative<std::shared_ptr<List>>(result.GetValue().value()))
-                {
-                    auto listPtr = std::get<std::shared_ptr<List>>(result.GetValue().value());
-                    for (const auto& element : listPtr->elements)
-                    {
-                        std::cout << Helper::Print(RTResult().Success(element)) << std::endl;
-                    }
-                }
-                else
-                {
-                    std::cout << Helper::Print(result) << std::endl;
-                }
-            }
-        }
+        std::string fileName = loadedFromFile ? std::filesystem::path(argv[1]).filename().string() : "<stdin>";
+        std::string mainFilePath = loadedFromFile ? argv[1] : std::filesystem::current_path().string();
+        runtime.Run(fileName, text, mainFilePath, loadedFromFile, Helper::argv_has(argc, argv, "--tokens"), Helper::argv_has(argc, argv, "--ast"));
 
         if (loadedFromFile)
             break;
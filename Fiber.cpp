@@ -0,0 +1,87 @@
+#include "Fiber.hpp"
+#include <cstdint>
+#include <new>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+#ifdef _WIN32
+
+Fiber::Fiber(Entry entry, void* argument) : entry(entry), argument(argument)
+{
+    fiber = CreateFiberEx(0, stackSize, FIBER_FLAG_FLOAT_SWITCH, Start, this);
+    if (fiber == nullptr)
+        throw std::bad_alloc();
+}
+
+Fiber::~Fiber()
+{
+    DeleteFiber(fiber);
+}
+
+void __stdcall Fiber::Start(void* fiber)
+{
+    Fiber* self = static_cast<Fiber*>(fiber);
+    self->entry(self->argument);
+}
+
+void Fiber::Resume()
+{
+    // A thread has to be a fiber itself before it can switch to one
+    caller = IsThreadAFiber() ? GetCurrentFiber() : ConvertThreadToFiber(nullptr);
+    SwitchToFiber(fiber);
+}
+
+void Fiber::Suspend()
+{
+    SwitchToFiber(caller);
+}
+
+#else
+
+Fiber::Fiber(Entry entry, void* argument) : entry(entry), argument(argument)
+{
+    size_t pageSize = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    mappedSize = stackSize + pageSize;
+    stack = mmap(nullptr, mappedSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if (stack == MAP_FAILED)
+        throw std::bad_alloc();
+    // The stack grows down, towards the guard page
+    mprotect(stack, pageSize, PROT_NONE);
+
+    getcontext(&context);
+    context.uc_stack.ss_sp = static_cast<char*>(stack) + pageSize;
+    context.uc_stack.ss_size = stackSize;
+    context.uc_link = nullptr;
+    uint64_t self = reinterpret_cast<uintptr_t>(this);
+    makecontext(&context, reinterpret_cast<void (*)()>(Start), 2, static_cast<unsigned int>(self >> 32), static_cast<unsigned int>(self & 0xffffffff));
+}
+
+Fiber::~Fiber()
+{
+    munmap(stack, mappedSize);
+}
+
+void Fiber::Start(unsigned int high, unsigned int low)
+{
+    Fiber* self = reinterpret_cast<Fiber*>(static_cast<uintptr_t>((static_cast<uint64_t>(high) << 32) | low));
+    self->entry(self->argument);
+}
+
+void Fiber::Resume()
+{
+    swapcontext(&caller, &context);
+}
+
+void Fiber::Suspend()
+{
+    swapcontext(&context, &caller);
+}
+
+#endif
\ No newline at end of file
@@ -0,0 +1,48 @@
+#pragma once
+#include <cstddef>
+
+#ifndef _WIN32
+#include <ucontext.h>
+#endif
+
+// Stack of its own that a thread switches onto and back, which lets a task keep its interpreter state on the C++
+// stack without a thread. Only the thread that resumes a fiber runs it, entry runs on its first Resume and must
+// never return, a finished job suspends and waits for the next Resume instead
+class Fiber
+{
+public:
+	using Entry = void (*)(void* argument);
+
+	Fiber(Entry entry, void* argument);
+	Fiber(const Fiber&) = delete;
+	Fiber& operator=(const Fiber&) = delete;
+	~Fiber();
+
+	// Runs the fiber on the calling thread until it suspends
+	void Resume();
+	// Called on the fiber, returns to the Resume that ran it
+	void Suspend();
+
+private:
+	// As deep as the stack of a thread, but only reserved, a fiber commits the pages the interpreter touches. The
+	// guard page below it turns an overflow into a crash instead of a write into other memory
+	static constexpr size_t stackSize = 8 * 1024 * 1024;
+
+	Entry entry;
+	void* argument;
+
+#ifdef _WIN32
+	void* fiber = nullptr;
+	void* caller = nullptr;
+
+	static void __stdcall Start(void* fiber);
+#else
+	void* stack = nullptr;
+	size_t mappedSize = 0;
+	ucontext_t context;
+	ucontext_t caller;
+
+	// makecontext only passes int arguments, the pointer is split in two
+	static void Start(unsigned int high, unsigned int low);
+#endif
+};
\ No newline at end of file
@@ -0,0 +1,142 @@
+#include "Heap.hpp"
+#include <algorithm>
+#include "BuildInFunctions.hpp"
+#include "Dict.hpp"
+#include "Iterator.hpp"
+
+void List::Trace(Heap& heap)
+{
+    for (const auto& element : elements)
+        heap.Mark(element);
+}
+
+Heap::~Heap()
+{
+    while (objects != nullptr)
+    {
+        GCObject* next = objects->next;
+        delete objects;
+        objects = next;
+    }
+}
+
+thread_local RootStack* Heap::threadRoots = nullptr;
+thread_local AllocationBuffer* Heap::threadBuffer = nullptr;
+thread_local uint32_t Heap::threadOwner = 0;
+
+void RootStack::Trace(Heap& heap) const
+{
+    for (const SymbolValue* value : values)
+        heap.Mark(*value);
+    for (const std::vector<SymbolValue>* vector : vectors)
+    {
+        for (const auto& value : *vector)
+            heap.Mark(value);
+    }
+    for (RootProvider* provider : providers)
+        provider->TraceRoots(heap);
+}
+
+void Heap::Collect()
+{
+    // Mark everything reachable from the roots
+    for (RootProvider* provider : rootProviders)
+        provider->TraceRoots(*this);
+    mainRoots.Trace(*this);
+    if (&Roots() != &mainRoots)
+        Roots().Trace(*this);
+
+    // Worklist instead of recursion, so deeply nested lists can't overflow the stack
+    while (!grayStack.empty())
+    {
+        GCObject* object = grayStack.back();
+        grayStack.pop_back();
+        object->Trace(*this);
+    }
+
+    // Sweep
+    size_t liveBytes = 0;
+    GCObject** link = &objects;
+    while (*link != nullptr)
+    {
+        GCObject* object = *link;
+        if (object->marked)
+        {
+            object->marked = false;
+            liveBytes += object->Size();
+            link = &object->next;
+        }
+        else
+        {
+            *link = object->next;
+            delete object;
+        }
+    }
+
+    bytesAllocated = liveBytes;
+    nextCollection = std::max(minCollectionThreshold, liveBytes * 2);
+}
+
+void Heap::Adopt(AllocationBuffer& buffer)
+{
+    if (buffer.objects == nullptr)
+        return;
+
+    buffer.last->next = objects;
+    objects = buffer.objects;
+    bytesAllocated += buffer.bytesAllocated;
+    buffer = AllocationBuffer();
+}
+
+uint32_t Heap::NewOwner()
+{
+    // 0 stands for no owner, it's skipped when the counter wraps around
+    uint32_t owner = lastOwner.fetch_add(1, std::memory_order_relaxed) + 1;
+    return owner != 0 ? owner : NewOwner();
+}
+
+void Heap::Mark(const SymbolValue& value)
+{
+    if (std::holds_alternative<List*>(value))
+        Mark(std::get<List*>(value));
+    else if (std::holds_alternative<Dict*>(value))
+        Mark(std::get<Dict*>(value));
+    else if (std::holds_alternative<BaseFunction*>(value))
+        Mark(std::get<BaseFunction*>(value));
+    else if (std::holds_alternative<Function*>(value))
+        Mark(std::get<Function*>(value));
+    else if (std::holds_alternative<Iterator*>(value))
+        Mark(std::get<Iterator*>(value));
+    else if (std::holds_alternative<Handle*>(value))
+        Mark(std::get<Handle*>(value));
+}
+
+void Heap::Mark(GCObject* object)
+{
+    if (object == nullptr || object->marked)
+        return;
+
+    object->marked = true;
+    grayStack.push_back(object);
+}
+
+void Heap::AddRootProvider(RootProvider* provider)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    provider->rootIndex = rootProviders.size();
+    rootProviders.push_back(provider);
+}
+
+void Heap::RemoveRootProvider(RootProvider* provider)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+
+    // Tasks and requests end in any order, the last provider takes the place of the removed one
+    size_t index = provider->rootIndex;
+    if (index < rootProviders.size() && rootProviders[index] == provider)
+    {
+        rootProviders[index] = rootProviders.back();
+        rootProviders[index]->rootIndex = index;
+        rootProviders.pop_back();
+    }
+}
\ No newline at end of file
@@ -0,0 +1,230 @@
+#pragma once
+#include <vector>
+#include <variant>
+#include <string>
+#include <memory>
+#include <cstdint>
+#include <mutex>
+#include <atomic>
+#include <utility>
+#include "Nodes.hpp"
+
+struct List;
+struct Dict;
+struct Function;
+class BaseFunction;
+class Iterator;
+class Handle;
+class SymbolTable;
+class Heap;
+using ListValue = std::variant<double, int64_t, std::string, Function*, List*, Dict*, BaseFunction*, Iterator*, Handle*>;
+using SymbolValue = std::variant<double, int64_t, std::string, Function*, List*, Dict*, BaseFunction*, Iterator*, Handle*>;
+
+// Base of every script-visible object that lives on the garbage collected heap
+class GCObject
+{
+public:
+	virtual ~GCObject() = default;
+
+	// Marks every heap object this object references
+	virtual void Trace(Heap&) {}
+	// Approximate amount of memory owned by this object, used for the collection trigger
+	virtual size_t Size() const { return sizeof(GCObject); }
+
+private:
+	friend class Heap;
+	GCObject* next = nullptr;
+	bool marked = false;
+	uint32_t owner = 0;	// Call of PARALLEL_MAP or PARALLEL_FOR that allocated it, 0 outside of them
+};
+
+struct List : public GCObject
+{
+	std::vector<ListValue> elements;
+
+	List(std::vector<ListValue> elements) : elements(std::move(elements)) {}
+
+	void Trace(Heap& heap) override;
+	size_t Size() const override { return sizeof(List) + elements.capacity() * sizeof(ListValue); }
+};
+
+// Value of a FUNC definition. It shares the immutable AST of the function, so defining a function only allocates this object.
+// Every call runs with the globals the function was defined in, wherever the value was passed to (VAR f = Test::func1)
+struct Function : public GCObject
+{
+	std::shared_ptr<FuncDefNode> prototype;
+	size_t arity;
+	size_t frameSize;
+	SymbolTable* globals;
+	// Owns the table if it belongs to an imported module, so the function can outlive every IMPORT of it. The
+	// program's globals outlive every function
+	std::shared_ptr<SymbolTable> module;
+
+	Function(std::shared_ptr<FuncDefNode> prototype, SymbolTable* globals, std::shared_ptr<SymbolTable> module)
+		: prototype(std::move(prototype)), arity(this->prototype->GetArgNameToks().size()), frameSize(this->prototype->GetFrameSize()), globals(globals), module(std::move(module)) {}
+
+	size_t Size() const override { return sizeof(Function); }
+};
+
+// Script values that are only compared by identity, like tasks
+class Handle : public GCObject
+{
+public:
+	virtual std::string ToString() const = 0;
+};
+
+// Anything that holds values for longer than a single Visit call (symbol tables, frames) registers itself as root provider
+class RootProvider
+{
+public:
+	virtual ~RootProvider() = default;
+	virtual void TraceRoots(Heap& heap) = 0;
+
+private:
+	friend class Heap;
+	size_t rootIndex = 0;	// Position in the heap's list while registered
+};
+
+// Temporary roots for values the interpreter holds on the C++ stack, see GCRoot. Every thread that runs script code
+// (the main program, each task and each PARALLEL_MAP worker) pushes onto a stack of its own, so they can be
+// suspended in any order and never push onto the same vector at once
+struct RootStack
+{
+	std::vector<const SymbolValue*> values;
+	std::vector<const std::vector<SymbolValue>*> vectors;
+	std::vector<RootProvider*> providers;	// Scoped providers like the arguments of a builtin call
+
+	void Trace(Heap& heap) const;
+};
+
+// Objects a PARALLEL_MAP worker allocated while the heap was concurrent. A worker links them here without taking
+// the heap's lock, nothing is collected until the batch ended and Heap::Adopt moved them into the heap
+struct AllocationBuffer
+{
+	GCObject* objects = nullptr;
+	GCObject* last = nullptr;
+	size_t bytesAllocated = 0;
+};
+
+class Heap
+{
+public:
+	Heap() = default;
+	Heap(const Heap&) = delete;
+	Heap& operator=(const Heap&) = delete;
+	~Heap();
+
+	template<typename T, typename... Args>
+	T* Allocate(Args&&... args)
+	{
+		T* object = new T(std::forward<Args>(args)...);
+		object->owner = threadOwner;
+		if (!concurrent)
+			Link(object);
+		else if (threadBuffer != nullptr)
+			Link(*threadBuffer, object);
+		else
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			Link(object);
+		}
+		return object;
+	}
+
+	// Only call at safe points, where every value still in use is reachable from a root. Collections are
+	// postponed while several threads run, their roots aren't all reachable from one thread
+	void CollectIfNeeded() { if (!concurrent && bytesAllocated >= nextCollection) Collect(); }
+	void Collect();
+
+	// Set while several threads run script code on this heap at once (PARALLEL_MAP). Only change it while no
+	// other thread runs
+	void SetConcurrent(bool concurrent) { this->concurrent = concurrent; }
+
+	void Mark(const SymbolValue& value);
+	void Mark(GCObject* object);
+
+	void AddRootProvider(RootProvider* provider);
+	void RemoveRootProvider(RootProvider* provider);
+
+	void PushRoot(const SymbolValue* value) { Roots().values.push_back(value); }
+	void PushRoot(const std::vector<SymbolValue>* values) { Roots().vectors.push_back(values); }
+	void PushRoot(RootProvider* provider) { Roots().providers.push_back(provider); }
+	void PopValueRoot() { Roots().values.pop_back(); }
+	void PopVectorRoot() { Roots().vectors.pop_back(); }
+	void PopProviderRoot() { Roots().providers.pop_back(); }
+
+	// Makes roots the stack the calling thread pushes onto. Threads that never set one use the main stack,
+	// the stacks of other threads aren't traced by Collect, their owner (a task) traces them
+	static void SetThreadRoots(RootStack* roots) { threadRoots = roots; }
+	// Makes the calling thread allocate into buffer while the heap is concurrent
+	static void SetThreadBuffer(AllocationBuffer* buffer) { threadBuffer = buffer; }
+	// Moves the objects of buffer into the heap and empties it. Only call while no other thread runs
+	void Adopt(AllocationBuffer& buffer);
+
+	// Each call of PARALLEL_MAP and PARALLEL_FOR gets a new owner, it owns what the calling thread allocates until
+	// the previous owner is set again. Calls that could run at the same time can only change the lists and
+	// dictionaries they own, the others may be shared with them
+	uint32_t NewOwner();
+	static uint32_t SetThreadOwner(uint32_t owner) { return std::exchange(threadOwner, owner); }
+	static bool MayChange(const GCObject* object) { return threadOwner == 0 || object->owner == threadOwner; }
+
+	size_t GetBytesAllocated() const { return bytesAllocated; }
+
+private:
+	static constexpr size_t minCollectionThreshold = 1024 * 1024;
+
+	GCObject* objects = nullptr;
+	size_t bytesAllocated = 0;
+	size_t nextCollection = minCollectionThreshold;
+
+	std::vector<RootProvider*> rootProviders;
+	RootStack mainRoots;
+	std::vector<GCObject*> grayStack;
+
+	bool concurrent = false;
+	std::atomic<uint32_t> lastOwner = 0;
+	std::mutex mutex;	// Guards the object list while concurrent and the root providers
+
+	static thread_local RootStack* threadRoots;
+	static thread_local AllocationBuffer* threadBuffer;
+	static thread_local uint32_t threadOwner;
+
+	RootStack& Roots() { return threadRoots != nullptr ? *threadRoots : mainRoots; }
+
+	void Link(GCObject* object)
+	{
+		object->next = objects;
+		objects = object;
+		bytesAllocated += object->Size();
+	}
+
+	static void Link(AllocationBuffer& buffer, GCObject* object)
+	{
+		if (buffer.objects == nullptr)
+			buffer.last = object;
+		object->next = buffer.objects;
+		buffer.objects = object;
+		buffer.bytesAllocated += object->Size();
+	}
+};
+
+// Keeps a value (or a growing vector of values) alive while it only exists on the C++ stack
+class GCRoot
+{
+public:
+	GCRoot(Heap& heap, const SymbolValue& value) : heap(heap), isVector(false) { heap.PushRoot(&value); }
+	GCRoot(Heap& heap, const std::vector<SymbolValue>& values) : heap(heap), isVector(true) { heap.PushRoot(&values); }
+	GCRoot(const GCRoot&) = delete;
+	GCRoot& operator=(const GCRoot&) = delete;
+	~GCRoot()
+	{
+		if (isVector)
+			heap.PopVectorRoot();
+		else
+			heap.PopValueRoot();
+	}
+
+private:
+	Heap& heap;
+	bool isVector;
+};
\ No newline at end of file
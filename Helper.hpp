@@ -3,8 +3,11 @@
 #include <vector>
 #include "Token.hpp"
 #include "Interpreter.hpp"
+#include "Dict.hpp"
+#include "Iterator.hpp"
 #include <sstream>
-#include <iomanip>
+#include <charconv>
+#include <cmath>
 
 class Helper
 {
@@ -24,7 +27,7 @@ public:
 		return result;
 	}
 
-    static std::string StringWithArrows(const std::string& text, Position pos_start, Position pos_end)
+    static std::string StringWithArrows(const std::string& text, const Position& pos_start, const Position& pos_end)
     {
         std::string result;
 
@@ -56,54 +59,117 @@ public:
         return result;
     }
 
-    static std::string Print(RTResult result)
+    static bool IsNumber(const SymbolValue& value)
     {
+        return std::holds_alternative<int64_t>(value) || std::holds_alternative<double>(value);
+    }
+
+    // Only valid if IsNumber(value)
+    static double ToDouble(const SymbolValue& value)
+    {
+        if (std::holds_alternative<int64_t>(value))
+            return static_cast<double>(std::get<int64_t>(value));
+        return std::get<double>(value);
+    }
+
+    // Only valid if IsNumber(value), doubles are truncated
+    static int64_t ToInt(const SymbolValue& value)
+    {
+        if (std::holds_alternative<int64_t>(value))
+            return std::get<int64_t>(value);
+        return static_cast<int64_t>(std::get<double>(value));
+    }
+
+    // Zero is false, every other number is true, non numbers are never true
+    static bool IsTruthy(const SymbolValue& value)
+    {
+        if (std::holds_alternative<int64_t>(value))
+            return std::get<int64_t>(value) != 0;
+        if (std::holds_alternative<double>(value))
+            return std::get<double>(value) != 0;
+        return false;
+    }
+
+    static std::string Print(const RTResult& result)
+    {
+        std::string out;
         if (result.GetValue().has_value())
+            Print(out, result.GetValue().value());
+        return out;
+    }
+
+    // Appends number with the fewest digits that still read back as the same value (0.1, not 0.100000000000000)
+    template<typename T>
+    static void PrintNumber(std::string& out, T number)
+    {
+        char buffer[32];
+        auto result = std::to_chars(buffer, buffer + sizeof(buffer), number);
+        out.append(buffer, result.ptr);
+    }
+
+    // Appends the printed value to out, nested lists and dictionaries write into the same string
+    static void Print(std::string& out, const SymbolValue& val)
+    {
+        if (std::holds_alternative<int64_t>(val))                       // Print integer
+            PrintNumber(out, std::get<int64_t>(val));
+        else if (std::holds_alternative<double>(val))                   // Print number
         {
-            auto val = result.GetValue().value();
-            if (std::holds_alternative<double>(val))                        // Print number
-            {
-                double number = std::get<double>(val);
+            double number = std::get<double>(val);
+
+            if (number == std::trunc(number) && std::abs(number) < 9223372036854775808.0)   // Print number as int
+                PrintNumber(out, static_cast<int64_t>(number));
+            else                                                            // Print number as double
+                PrintNumber(out, number);
+        }
+        else if (std::holds_alternative<std::string>(val))              // Print string
+            out += std::get<std::string>(val);
+        else if (std::holds_alternative<List*>(val))    // Print list
+        {
+            const auto& list = std::get<List*>(val);
 
-                if (number == static_cast<int>(number))                         // Print number as int
-                    return std::to_string(static_cast<int>(number));
-                else                                                            // Print number as double
+            if (list->elements.size() == 1)                                 // Print the one result in the list directly
+                Print(out, list->elements[0]);
+            else                                                            // Print the results in the list as list
+            {
+                out += '[';
+                for (size_t i = 0; i < list->elements.size(); ++i)
                 {
-                    std::ostringstream oss;
-                    oss << std::fixed << std::setprecision(15) << std::get<double>(val);
-                    return oss.str();
+                    if (i != 0)
+                        out += ", ";
+                    Print(out, list->elements[i]);
                 }
+                out += ']';
             }
-            else if (std::holds_alternative<std::string>(val))              // Print string
-                return (std::get<std::string>(val));
-            else if (std::holds_alternative<std::shared_ptr<List>>(val))    // Print list
+        }
+        else if (std::holds_alternative<Dict*>(val))                    // Print dictionary in insertion order
+        {
+            const auto& entries = std::get<Dict*>(val)->GetEntries();
+
+            out += '{';
+            bool first = true;
+            for (const auto& entry : entries)
             {
-                const auto& list = std::get<std::shared_ptr<List>>(val);
+                if (entry.erased)
+                    continue;
 
-                if (list->elements.size() == 1)                                 // Print the one result in the list directly
-                    return Print(RTResult().Success(list->elements[0]));
-                else                                                            // Print the results in the list as list
-                {
-                    std::string result = "[";
-                    for (size_t i = 0; i < list->elements.size(); ++i)
-                    {
-                        result += Print(RTResult().Success(list->elements[i]));
-                        if (i != list->elements.size() - 1)
-                        {
-                            result += ", ";
-                        }
-                    }
-                    result += "]";
-                    return result;
-                }
+                if (!first)
+                    out += ", ";
+                first = false;
+
+                Print(out, FromDictKey(entry.key));
+                out += ": ";
+                Print(out, entry.value);
             }
-            else if (std::holds_alternative<std::shared_ptr<BaseFunction>>(val))              // Print build in function name
-                return (std::get<std::shared_ptr<BaseFunction>>(val)->ToString());
-            else if (std::holds_alternative<std::shared_ptr<FuncDefNode>>(val))              // Print function name
-                return (std::get<std::shared_ptr<FuncDefNode>>(val)->Repr());
+            out += '}';
         }
-        else
-            return "";
+        else if (std::holds_alternative<BaseFunction*>(val))              // Print build in function name
+            out += std::get<BaseFunction*>(val)->ToString();
+        else if (std::holds_alternative<Function*>(val))              // Print function name
+            out += std::get<Function*>(val)->prototype->Repr();
+        else if (std::holds_alternative<Iterator*>(val))
+            out += std::get<Iterator*>(val)->ToString();
+        else if (std::holds_alternative<Handle*>(val))
+            out += std::get<Handle*>(val)->ToString();
     }
 
     static bool argv_has(int argc, char* argv[], const std::string& target)
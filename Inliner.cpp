@@ -0,0 +1,83 @@
+#include "Inliner.hpp"
+
+std::shared_ptr<Node> Inliner::Inline(const FuncDefNode& funcDef, const CallNode& call)
+{
+    const auto& args = call.GetArgNodes();
+    if (!funcDef.GetShouldAutoReturn() || args.size() != funcDef.GetArgNameToks().size() || funcDef.GetFrameSize() != args.size())
+        return nullptr;
+
+    for (const auto& arg : args)
+    {
+        if (dynamic_cast<NumberNode*>(arg.get()) == nullptr && dynamic_cast<StringNode*>(arg.get()) == nullptr && dynamic_cast<VarAccessNode*>(arg.get()) == nullptr)
+            return nullptr;
+    }
+
+    Inliner inliner(args);
+    if (!inliner.CanInline(funcDef.GetBodyNode()))
+        return nullptr;
+
+    for (int count : inliner.uses)
+    {
+        if (count == 0)
+            return nullptr;
+    }
+
+    return inliner.Substitute(funcDef.GetBodyNode());
+}
+
+int Inliner::ParamIndex(const VarAccessNode& access) const
+{
+    // Arrow functions without locals only have parameter slots
+    if (access.IsNamespaced() || access.GetSlot() < 0)
+        return -1;
+    return access.GetSlot();
+}
+
+bool Inliner::CanInline(const std::shared_ptr<Node>& node)
+{
+    if (++nodeCount > maxNodes)
+        return false;
+
+    if (dynamic_cast<NumberNode*>(node.get()) != nullptr || dynamic_cast<StringNode*>(node.get()) != nullptr)
+        return true;
+
+    if (auto access = dynamic_cast<VarAccessNode*>(node.get()))
+    {
+        int param = ParamIndex(*access);
+        if (param >= 0)
+            uses[param]++;
+        return true;
+    }
+
+    if (auto binOp = dynamic_cast<BinOpNode*>(node.get()))
+    {
+        // AND / OR may skip their right side, which would skip the evaluation of an argument
+        if (binOp->GetOp() == BinOpNode::Op::And || binOp->GetOp() == BinOpNode::Op::Or)
+            return false;
+        return CanInline(binOp->GetLeftNode()) && CanInline(binOp->GetRightNode());
+    }
+
+    if (auto unaryOp = dynamic_cast<UnaryOpNode*>(node.get()))
+        return CanInline(unaryOp->GetNode());
+
+    return false;
+}
+
+std::shared_ptr<Node> Inliner::Substitute(const std::shared_ptr<Node>& node)
+{
+    if (auto access = dynamic_cast<VarAccessNode*>(node.get()))
+    {
+        int param = ParamIndex(*access);
+        return param >= 0 ? args[param] : node;
+    }
+
+    // Operators are copied, so every call site gets its own quickening state
+    if (auto binOp = dynamic_cast<BinOpNode*>(node.get()))
+        return std::make_shared<BinOpNode>(Substitute(binOp->GetLeftNode()), binOp->GetOpToken(), Substitute(binOp->GetRightNode()));
+
+    if (auto unaryOp = dynamic_cast<UnaryOpNode*>(node.get()))
+        return std::make_shared<UnaryOpNode>(unaryOp->GetOpToken(), Substitute(unaryOp->GetNode()));
+
+    // Literals and globals are shared with the function body
+    return node;
+}
@@ -0,0 +1,31 @@
+#pragma once
+#include <memory>
+#include <vector>
+#include "Nodes.hpp"
+
+// Builds a copy of a small arrow function body for one call site, with the parameters replaced by the argument
+// nodes, so the interpreter can evaluate it in the caller's frame instead of making a call. Only bodies made of
+// arithmetic / comparison operators, literals and variables qualify, so an inlined body never calls anything (and
+// can't recurse). Arguments have to be literals or variables, which give the same value no matter how often or
+// how late they are evaluated, and every parameter has to be used, so a bad argument still fails.
+class Inliner
+{
+public:
+	// Maximum number of nodes in an inlined body
+	static constexpr int maxNodes = 16;
+
+	// Returns nullptr if the call can't be inlined
+	static std::shared_ptr<Node> Inline(const FuncDefNode& funcDef, const CallNode& call);
+
+private:
+	Inliner(const std::vector<std::shared_ptr<Node>>& args) : args(args), uses(args.size(), 0) {}
+
+	const std::vector<std::shared_ptr<Node>>& args;
+	std::vector<int> uses;
+	int nodeCount = 0;
+
+	bool CanInline(const std::shared_ptr<Node>& node);
+	std::shared_ptr<Node> Substitute(const std::shared_ptr<Node>& node);
+	// Parameter index of a variable access, -1 for globals
+	int ParamIndex(const VarAccessNode& access) const;
+};
\ No newline at end of file
@@ -1,12 +1,20 @@
 #include "Interpreter.hpp"
 #include <functional>
-#include <fstream>
-#include <sstream>
-#include "Lexer.hpp"
-#include "Parser.hpp"
 #include <filesystem>
+#include "Helper.hpp"
+#include "Dict.hpp"
+#include "Inliner.hpp"
+#include "Iterator.hpp"
+#include "Task.hpp"
+#include "ModuleLoader.hpp"
+
+// Built out of line, Visit is on every level of the recursion and shouldn't carry the error's temporaries in its stack frame
+static RTResult UnknownNodeError()
+{
+    return RTResult().Failure(std::make_unique<RuntimeError>(Position(), Position(), "Unknown node type"));
+}
 
-RTResult Interpreter::Visit(std::shared_ptr<Node> node)
+RTResult Interpreter::Visit(const std::shared_ptr<Node>& node)
 {
     if (auto number = dynamic_cast<NumberNode*>(node.get()))
         return Visit_NumberNode(*number);
@@ -26,12 +34,14 @@ RTResult Interpreter::Visit(std::shared_ptr<Node> node)
         return Visit_ForNode(*for_);
     if (auto while_ = dynamic_cast<WhileNode*>(node.get()))
         return Visit_WhileNode(*while_);
-    if (auto funcDef = dynamic_cast<FuncDefNode*>(node.get()))
-        return Visit_FuncDefNode(*funcDef);
+    if (dynamic_cast<FuncDefNode*>(node.get()) != nullptr)
+        return Visit_FuncDefNode(std::static_pointer_cast<FuncDefNode>(node));
     if (auto call = dynamic_cast<CallNode*>(node.get()))
         return Visit_CallNode(*call);
     if (auto list = dynamic_cast<ListNode*>(node.get()))
         return Visit_ListNode(*list);
+    if (auto dict = dynamic_cast<DictNode*>(node.get()))
+        return Visit_DictNode(*dict);
     if (auto return_ = dynamic_cast<ReturnNode*>(node.get()))
         return Visit_ReturnNode(*return_);
     if (auto continue_ = dynamic_cast<ContinueNode*>(node.get()))
@@ -40,21 +50,131 @@ RTResult Interpreter::Visit(std::shared_ptr<Node> node)
         return Visit_BreakNode(*break_);
     if (auto import_ = dynamic_cast<ImportNode*>(node.get()))
         return Visit_ImportNode(*import_);
+    if (auto forIn = dynamic_cast<ForInNode*>(node.get()))
+        return Visit_ForInNode(*forIn);
+    if (auto yield = dynamic_cast<YieldNode*>(node.get()))
+        return Visit_YieldNode(*yield);
+    if (auto spawn = dynamic_cast<SpawnNode*>(node.get()))
+        return Visit_SpawnNode(*spawn);
+    if (auto await = dynamic_cast<AwaitNode*>(node.get()))
+        return Visit_AwaitNode(*await);
+
+    return UnknownNodeError();
+}
 
-    return RTResult().Failure(std::make_unique<RuntimeError>(Position(), Position(), "Unknown node type"));
+std::optional<SymbolValue> Interpreter::GetVariable(VarAccessNode& node)
+{
+    // Locals that weren't assigned yet fall back to the global of the same name, so "VAR x = x + 1" keeps working
+    int slot = node.GetSlot();
+    if (slot >= 0)
+    {
+        const auto& local = frames[frameBase + slot];
+        if (local.has_value())
+            return local;
+    }
+
+    const SymbolValue* value = LookupGlobal(*globals, std::get<std::string>(node.GetVarNameToken().GetValue()), node.GetCache());
+    if (value == nullptr)
+        return std::nullopt;
+    return *value;
 }
 
-RTResult Interpreter::Visit_NumberNode(NumberNode& node)
+void Interpreter::SetVariable(const std::string& name, int slot, const SymbolValue& value, VariableCache& cache)
 {
-    auto val = node.GetToken().GetValue();
-    double num = 0;
+    if (slot >= 0)
+    {
+        frames[frameBase + slot] = value;
+        return;
+    }
 
-    if (std::holds_alternative<int>(val))
-        num = static_cast<double>(std::get<int>(val));
-    else if (std::holds_alternative<double>(val))
-        num = std::get<double>(val);
+    // Assignments always go to the current globals table itself, so its index stays valid as long as the table is the same
+    if (cache.tableId == globals->GetId() && cache.owner == globals)
+    {
+        globals->ValueAt(cache.index) = value;
+        return;
+    }
 
-    return RTResult().Success(num);
+    cache.index = globals->Set(name, value);
+    cache.tableId = globals->GetId();
+    cache.chainVersion = globals->GetChainVersion();
+    cache.owner = globals;
+}
+
+const SymbolValue* Interpreter::LookupGlobal(SymbolTable& table, const std::string& name, VariableCache& cache)
+{
+    // The cached slot is valid until a name is added anywhere in the chain, because that could shadow it
+    uint64_t chainVersion = table.GetChainVersion();
+    if (cache.tableId == table.GetId() && cache.chainVersion == chainVersion)
+        return &cache.owner->ValueAt(cache.index);
+
+    SymbolTable* owner;
+    size_t index;
+    if (!table.Find(name, owner, index))
+        return nullptr;
+
+    if (isWorker)
+        return &owner->ValueAt(index);
+
+    cache.tableId = table.GetId();
+    cache.chainVersion = chainVersion;
+    cache.owner = owner;
+    cache.index = index;
+    return &owner->ValueAt(index);
+}
+
+SymbolTable* Interpreter::LookupModule(VarAccessNode& node, std::string& error)
+{
+    // The aliases of the file the node is in, a function of a module runs with the globals of that module
+    const std::string& alias = node.GetModuleAlias().value();
+    SymbolTable::ModuleAliases* aliases = globals->FindModuleAliases();
+    if (aliases == nullptr)
+    {
+        error = "Module '" + alias + "' not found";
+        return nullptr;
+    }
+
+    VariableCache& cache = node.GetCache();
+    if (cache.modulesGeneration == aliases->generation)
+        return cache.moduleTable;
+
+    auto it = aliases->imported.find(alias);
+    if (it == aliases->imported.end())
+    {
+        // A LAZY IMPORT, its module runs now that the first of its names is used
+        auto lazy = aliases->lazy.find(alias);
+        if (lazy == aliases->lazy.end())
+        {
+            error = "Module '" + alias + "' not found";
+            return nullptr;
+        }
+        if (isWorker)
+        {
+            error = "Module '" + alias + "' is imported lazily, its first use can't be inside PARALLEL_MAP or PARALLEL_FOR";
+            return nullptr;
+        }
+
+        // The module's code can call back into this file, which could import and change the aliases meanwhile
+        std::filesystem::path filePath = lazy->second;
+        std::shared_ptr<SymbolTable> table = LoadModule(filePath, error);
+        if (table == nullptr)
+            return nullptr;
+
+        aliases->lazy.erase(alias);
+        it = aliases->imported.insert_or_assign(alias, std::move(table)).first;
+        aliases->generation = SymbolTable::NextModulesGeneration();
+    }
+
+    if (isWorker)
+        return it->second.get();
+
+    cache.modulesGeneration = aliases->generation;
+    cache.moduleTable = it->second.get();
+    return cache.moduleTable;
+}
+
+RTResult Interpreter::Visit_NumberNode(NumberNode& node)
+{
+    return std::visit([](auto number) { return RTResult().Success(number); }, node.GetValue());
 }
 
 RTResult Interpreter::Visit_StringNode(StringNode& node)
@@ -67,104 +187,402 @@ RTResult Interpreter::Visit_ListNode(ListNode& node)
     RTResult res;
 
     std::vector<ListValue> elements;
-    for (auto elementNode : node.GetElementNodes())
+    GCRoot elementsRoot(heap, elements);
+
+    // Function and IF bodies are lists as well, a resumed generator continues at the element it yielded in
+    const auto& elementNodes = node.GetElementNodes();
+    size_t i = 0;
+    if (resuming)
     {
-        auto result = Visit(elementNode);
+        ResumePoint point = TakeResumePoint();
+        i = point.index;
+        elements = std::move(point.elements);
+    }
+
+    for (; i < elementNodes.size(); ++i)
+    {
+        auto result = Visit(elementNodes[i]);
+        if (result.IsYield())
+            return Suspend(std::move(result), { i, {}, std::move(elements) });
         if (result.ShouldReturn())
             return result;
 
         if (result.GetValue().has_value())
-            elements.push_back(result.GetValue().value());
+            elements.push_back(std::move(result.GetValue().value()));
+    }
+    return res.Success(heap.Allocate<List>(std::move(elements)));
+}
+
+// Runs the elements of a statement block for their effect only, stops at the first one that has to hand a result up
+RTResult Interpreter::Visit_Statements(ListNode& node)
+{
+    const auto& statements = node.GetElementNodes();
+    size_t i = resuming ? TakeResumePoint().index : 0;
+
+    for (; i < statements.size(); ++i)
+    {
+        RTResult result = Visit(statements[i]);
+        if (result.IsYield())
+            return Suspend(std::move(result), { i, {}, {} });
+        if (result.ShouldReturn())
+            return result;
+    }
+    return RTResult().Success(std::nullopt);
+}
+
+RTResult Interpreter::Visit_DictNode(DictNode& node)
+{
+    RTResult res;
+
+    // Allocated first and rooted, so values stored into it survive collections while the rest is evaluated
+    SymbolValue dictValue = heap.Allocate<Dict>();
+    GCRoot dictRoot(heap, dictValue);
+    Dict* dict = std::get<Dict*>(dictValue);
+
+    for (const auto& [keyNode, valueNode] : node.GetEntryNodes())
+    {
+        auto keyResult = Visit(keyNode);
+        if (keyResult.ShouldReturn())
+            return keyResult;
+
+        std::optional<DictKey> key = ToDictKey(keyResult.GetValue().value());
+        if (!key.has_value())
+            return res.Failure(std::make_unique<RuntimeError>(keyNode->GetPosStart(), keyNode->GetPosEnd(), "Dictionary keys have to be numbers or strings"));
+
+        auto valueResult = Visit(valueNode);
+        if (valueResult.ShouldReturn())
+            return valueResult;
+
+        if (valueResult.GetValue().has_value())
+            dict->Insert(std::move(key.value()), std::move(valueResult.GetValue().value()));
+    }
+    return res.Success(dict);
+}
+
+// Integer results that don't fit into 64 bits fall back to double instead of wrapping around
+static bool AddInt(int64_t a, int64_t b, int64_t& result)
+{
+    if ((b > 0 && a > INT64_MAX - b) || (b < 0 && a < INT64_MIN - b))
+        return false;
+    result = a + b;
+    return true;
+}
+
+static bool SubInt(int64_t a, int64_t b, int64_t& result)
+{
+    if ((b < 0 && a > INT64_MAX + b) || (b > 0 && a < INT64_MIN + b))
+        return false;
+    result = a - b;
+    return true;
+}
+
+static bool MulInt(int64_t a, int64_t b, int64_t& result)
+{
+    if (a > 0)
+    {
+        if ((b > 0 && a > INT64_MAX / b) || (b <= 0 && b < INT64_MIN / a))
+            return false;
+    }
+    else if (a < 0)
+    {
+        if ((b > 0 && a < INT64_MIN / b) || (b <= 0 && b < INT64_MAX / a))
+            return false;
+    }
+    result = a * b;
+    return true;
+}
+
+static std::string RepeatString(const std::string& str, int64_t times)
+{
+    std::string result;
+    if (times > 0)
+        result.reserve(str.size() * times);
+    for (int64_t i = 0; i < times; ++i)
+        result += str;
+    return result;
+}
+
+// Both operand types packed into one number (the variant has at most 16 alternatives), so a quickened node guards with one comparison
+static uint32_t TypePair(const SymbolValue& l, const SymbolValue& r)
+{
+    return static_cast<uint32_t>(l.index() * 16 + r.index());
+}
+
+constexpr uint32_t doubleIndex = 0;
+constexpr uint32_t intIndex = 1;
+constexpr uint32_t stringIndex = 2;
+constexpr uint32_t intIntPair = intIndex * 16 + intIndex;
+constexpr uint32_t strStrPair = stringIndex * 16 + stringIndex;
+// Bit per type pair (of the first 64), set for two numbers of which at least one is a double
+constexpr uint64_t numNumPairs = (1ULL << (doubleIndex * 16 + doubleIndex)) | (1ULL << (doubleIndex * 16 + intIndex)) | (1ULL << (intIndex * 16 + doubleIndex));
+
+static BinOpNode::Quickening QuickeningFor(BinOpNode::Op op, uint32_t types)
+{
+    if (op == BinOpNode::Op::At || op == BinOpNode::Op::And || op == BinOpNode::Op::Or || op == BinOpNode::Op::Unknown)
+        return BinOpNode::Quickening::Generic;
+    if (types == intIntPair)
+        return BinOpNode::Quickening::IntInt;
+    if (types < 64 && ((numNumPairs >> types) & 1))
+        return BinOpNode::Quickening::NumNum;
+    if (types == strStrPair && op == BinOpNode::Op::Add)
+        return BinOpNode::Quickening::StrStr;
+    return BinOpNode::Quickening::Generic;
+}
+
+static RTResult DivisionByZero(BinOpNode& node)
+{
+    return RTResult().Failure(std::make_unique<RuntimeError>(node.GetOpToken().GetPosStart(), node.GetOpToken().GetPosEnd(), "Division by zero"));
+}
+
+static RTResult UnsupportedOperands(BinOpNode& node)
+{
+    return RTResult().Failure(std::make_unique<RuntimeError>(node.GetOpToken().GetPosStart(), node.GetOpToken().GetPosEnd(), "Unsupported operand types for binary operation"));
+}
+
+// Integer arithmetic, '/' and '^' always produce doubles and overflowing results fall back to doubles
+static RTResult IntBinOp(BinOpNode& node, int64_t l, int64_t r)
+{
+    int64_t result;
+
+    switch (node.GetOp())
+    {
+    case BinOpNode::Op::Add:
+        if (AddInt(l, r, result))
+            return RTResult().Success(result);
+        return RTResult().Success(static_cast<double>(l) + static_cast<double>(r));
+    case BinOpNode::Op::Sub:
+        if (SubInt(l, r, result))
+            return RTResult().Success(result);
+        return RTResult().Success(static_cast<double>(l) - static_cast<double>(r));
+    case BinOpNode::Op::Mul:
+        if (MulInt(l, r, result))
+            return RTResult().Success(result);
+        return RTResult().Success(static_cast<double>(l) * static_cast<double>(r));
+    case BinOpNode::Op::Div:
+        if (r == 0)
+            return DivisionByZero(node);
+        return RTResult().Success(static_cast<double>(l) / static_cast<double>(r));
+    case BinOpNode::Op::Pow:
+        return RTResult().Success(pow(static_cast<double>(l), static_cast<double>(r)));
+    case BinOpNode::Op::Eq:
+        return RTResult().Success(static_cast<int64_t>(l == r));
+    case BinOpNode::Op::Neq:
+        return RTResult().Success(static_cast<int64_t>(l != r));
+    case BinOpNode::Op::Lt:
+        return RTResult().Success(static_cast<int64_t>(l < r));
+    case BinOpNode::Op::Gt:
+        return RTResult().Success(static_cast<int64_t>(l > r));
+    case BinOpNode::Op::Lte:
+        return RTResult().Success(static_cast<int64_t>(l <= r));
+    case BinOpNode::Op::Gte:
+        return RTResult().Success(static_cast<int64_t>(l >= r));
+    default:
+        return UnsupportedOperands(node);
+    }
+}
+
+static RTResult NumBinOp(BinOpNode& node, double l, double r)
+{
+    switch (node.GetOp())
+    {
+    case BinOpNode::Op::Add:
+        return RTResult().Success(l + r);
+    case BinOpNode::Op::Sub:
+        return RTResult().Success(l - r);
+    case BinOpNode::Op::Mul:
+        return RTResult().Success(l * r);
+    case BinOpNode::Op::Div:
+        if (r == 0)
+            return DivisionByZero(node);
+        return RTResult().Success(l / r);
+    case BinOpNode::Op::Pow:
+        return RTResult().Success(pow(l, r));
+    case BinOpNode::Op::Eq:
+        return RTResult().Success(static_cast<int64_t>(l == r));
+    case BinOpNode::Op::Neq:
+        return RTResult().Success(static_cast<int64_t>(l != r));
+    case BinOpNode::Op::Lt:
+        return RTResult().Success(static_cast<int64_t>(l < r));
+    case BinOpNode::Op::Gt:
+        return RTResult().Success(static_cast<int64_t>(l > r));
+    case BinOpNode::Op::Lte:
+        return RTResult().Success(static_cast<int64_t>(l <= r));
+    case BinOpNode::Op::Gte:
+        return RTResult().Success(static_cast<int64_t>(l >= r));
+    default:
+        return UnsupportedOperands(node);
+    }
+}
+
+static bool IsLogical(const std::shared_ptr<Node>& node, BinOpNode*& binOp)
+{
+    binOp = dynamic_cast<BinOpNode*>(node.get());
+    return binOp != nullptr && (binOp->GetOp() == BinOpNode::Op::And || binOp->GetOp() == BinOpNode::Op::Or);
+}
+
+RTResult Interpreter::Visit_LogicalOperand(BinOpNode& node, const std::shared_ptr<Node>& operand, bool& isTrue)
+{
+    BinOpNode* inner;
+    if (IsLogical(operand, inner))
+        return Visit_LogicalNode(*inner, isTrue);
+
+    RTResult res = Visit(operand);
+    if (res.ShouldReturn())
+        return res;
+
+    if (!res.GetValue().has_value() || !Helper::IsNumber(res.GetValue().value()))
+        return UnsupportedOperands(node);
+
+    isTrue = Helper::IsTruthy(res.GetValue().value());
+    return res;
+}
+
+// AND / OR only evaluate their right side if the left side doesn't decide the result already
+RTResult Interpreter::Visit_LogicalNode(BinOpNode& node, bool& isTrue)
+{
+    RTResult res = Visit_LogicalOperand(node, node.GetLeftNode(), isTrue);
+    if (res.ShouldReturn() || isTrue == (node.GetOp() == BinOpNode::Op::Or))
+        return res;
+
+    return Visit_LogicalOperand(node, node.GetRightNode(), isTrue);
+}
+
+// Evaluates an IF / WHILE condition straight to a bool, so AND / OR chains jump to the branch without building values
+RTResult Interpreter::Visit_Condition(const std::shared_ptr<Node>& node, bool& isTrue)
+{
+    // The ELSE case is stored as an if case without condition
+    if (node == nullptr)
+    {
+        isTrue = true;
+        return RTResult().Success(std::nullopt);
     }
-    return res.Success(std::make_shared<List>(List(elements)));
+
+    BinOpNode* logical;
+    if (IsLogical(node, logical))
+        return Visit_LogicalNode(*logical, isTrue);
+
+    RTResult res = Visit(node);
+    if (!res.ShouldReturn())
+        isTrue = Helper::IsTruthy(res.GetValue().value());
+    return res;
 }
 
 RTResult Interpreter::Visit_BinOpNode(BinOpNode& node)
 {
-    auto left = Visit(node.GetLeftNode());
-    auto right = Visit(node.GetRightNode());
+    using Op = BinOpNode::Op;
+    using Quickening = BinOpNode::Quickening;
 
+    if (node.GetOp() == Op::And || node.GetOp() == Op::Or)
+    {
+        bool isTrue = false;
+        RTResult res = Visit_LogicalNode(node, isTrue);
+        if (res.ShouldReturn())
+            return res;
+        return RTResult().Success(static_cast<int64_t>(isTrue));
+    }
+
+    auto left = Visit(node.GetLeftNode());
     if (left.ShouldReturn())
         return left;
+
+    const auto& l = left.GetValue().value();
+    GCRoot leftRoot(heap, l);
+
+    auto right = Visit(node.GetRightNode());
     if (right.ShouldReturn())
         return right;
 
-    auto l = left.GetValue().value();
-    auto r = right.GetValue().value();
+    const auto& r = right.GetValue().value();
+    uint32_t types = TypePair(l, r);
 
-    Position pos_start = node.GetOpToken().GetPosStart();
-    Position pos_end = node.GetOpToken().GetPosEnd();
+    // The first evaluation specialises the node for the operand types it sees. A specialised node only checks
+    // its guard, if that fails the site is polymorphic and stays on the generic path below from then on.
+    // Workers use the specialisation without storing one
+    Quickening quickening = node.GetQuickening();
+    if (quickening == Quickening::None)
+    {
+        quickening = QuickeningFor(node.GetOp(), types);
+        if (!isWorker)
+            node.SetQuickening(quickening);
+    }
 
-    if (node.GetOpToken().GetType() == TT_PLUS)  // Handle addition
+    switch (quickening)
+    {
+    case Quickening::IntInt:
+        if (types == intIntPair)
+            return IntBinOp(node, std::get<int64_t>(l), std::get<int64_t>(r));
+        break;
+    case Quickening::NumNum:
+        if (types < 64 && ((numNumPairs >> types) & 1))
+            return NumBinOp(node, Helper::ToDouble(l), Helper::ToDouble(r));
+        break;
+    case Quickening::StrStr:
+        if (types == strStrPair)
+            return RTResult().Success(std::get<std::string>(l) + std::get<std::string>(r));
+        break;
+    default:
+        break;
+    }
+    if (quickening != Quickening::Generic && !isWorker)
+        node.SetQuickening(Quickening::Generic);
+
+    const Position& pos_start = node.GetOpToken().GetPosStart();
+    const Position& pos_end = node.GetOpToken().GetPosEnd();
+
+    const Op op = node.GetOp();
+
+    if (op != Op::At)  // Numbers work the same for every other operator
+    {
+        if (types == intIntPair)
+            return IntBinOp(node, std::get<int64_t>(l), std::get<int64_t>(r));
+        if (Helper::IsNumber(l) && Helper::IsNumber(r))
+            return NumBinOp(node, Helper::ToDouble(l), Helper::ToDouble(r));
+    }
+
+    if (op == Op::Add)  // Handle addition
     {
         // String + String
-        if (std::holds_alternative<std::string>(l) && std::holds_alternative<std::string>(r))
+        if (types == strStrPair)
         {
             std::string result = std::get<std::string>(l) + std::get<std::string>(r);
-            return RTResult().Success(result);
-        }
-        // Number + Number
-        else if (std::holds_alternative<double>(l) && std::holds_alternative<double>(r))
-        {
-            double result = std::get<double>(l) + std::get<double>(r);
-            return RTResult().Success(result);
+            return RTResult().Success(std::move(result));
         }
         //List + ListVar
-        else if (std::holds_alternative<std::shared_ptr<List>>(l))
+        else if (std::holds_alternative<List*>(l))
         {
-            List result(std::get<std::shared_ptr<List>>(l)->elements);
-            result.elements.push_back(ListValue(r));
-            return RTResult().Success(std::make_shared<List>(result));
+            List* result = heap.Allocate<List>(std::get<List*>(l)->elements);
+            result->elements.push_back(ListValue(r));
+            return RTResult().Success(result);
         }
 
     }
-    else if (node.GetOpToken().GetType() == TT_MUL)  // Handle multiplication
+    else if (op == Op::Mul)  // Handle multiplication
     {
         // String * Number
-        if (std::holds_alternative<std::string>(l) && std::holds_alternative<double>(r))
-        {
-            std::string str = std::get<std::string>(l);
-            int times = static_cast<int>(std::get<double>(r));
-            std::string result;
-            for (int i = 0; i < times; ++i)
-                result += str;
-            return RTResult().Success(result);
-        }
+        if (std::holds_alternative<std::string>(l) && Helper::IsNumber(r))
+            return RTResult().Success(RepeatString(std::get<std::string>(l), Helper::ToInt(r)));
         // Number * String
-        else if (std::holds_alternative<double>(l) && std::holds_alternative<std::string>(r))
-        {
-            int times = static_cast<int>(std::get<double>(l));
-            std::string str = std::get<std::string>(r);
-            std::string result;
-            for (int i = 0; i < times; ++i)
-                result += str;
-            return RTResult().Success(result);
-        }
-        // Number * Number
-        else if (std::holds_alternative<double>(l) && std::holds_alternative<double>(r))
-        {
-            double result = std::get<double>(l) * std::get<double>(r);
-            return RTResult().Success(result);
-        }
+        else if (Helper::IsNumber(l) && std::holds_alternative<std::string>(r))
+            return RTResult().Success(RepeatString(std::get<std::string>(r), Helper::ToInt(l)));
         //List * List
-        else if (std::holds_alternative<std::shared_ptr<List>>(l) && std::holds_alternative<std::shared_ptr<List>>(r))
+        else if (std::holds_alternative<List*>(l) && std::holds_alternative<List*>(r))
         {
-            List result(std::get<std::shared_ptr<List>>(l)->elements);
+            List* result = heap.Allocate<List>(std::get<List*>(l)->elements);
 
-            for (ListValue listVar : std::get<std::shared_ptr<List>>(r)->elements)
-                result.elements.push_back(listVar);
+            for (const ListValue& listVar : std::get<List*>(r)->elements)
+                result->elements.push_back(listVar);
 
-            return RTResult().Success(std::make_shared<List>(result));
+            return RTResult().Success(result);
         }
     }
-    else if (node.GetOpToken().GetType() == TT_AT)  // Handle list indexing with '@'
+    else if (op == Op::At)  // Handle list indexing with '@'
     {
-        if (std::holds_alternative<std::shared_ptr<List>>(l) && std::holds_alternative<double>(r))
+        if (std::holds_alternative<List*>(l) && Helper::IsNumber(r))
         {
-            auto listVal = std::get<std::shared_ptr<List>>(l);
-            int index = static_cast<int>(std::get<double>(r));
+            auto listVal = std::get<List*>(l);
+            int64_t index = Helper::ToInt(r);
 
-            if (index < 0 || index >= listVal->elements.size())
+            if (index < 0 || index >= static_cast<int64_t>(listVal->elements.size()))
             {
                 return RTResult().Failure(
                     std::make_unique<RuntimeError>(
@@ -173,7 +591,19 @@ RTResult Interpreter::Visit_BinOpNode(BinOpNode& node)
                 );
             }
 
-            return RTResult().Success(ListValue(listVal->elements[index]));
+            return RTResult().Success(listVal->elements[index]);
+        }
+        else if (std::holds_alternative<Dict*>(l))
+        {
+            std::optional<DictKey> key = ToDictKey(r);
+            if (!key.has_value())
+                return RTResult().Failure(std::make_unique<RuntimeError>(pos_start, pos_end, "Dictionary keys have to be numbers or strings"));
+
+            SymbolValue* value = std::get<Dict*>(l)->Find(key.value());
+            if (value == nullptr)
+                return RTResult().Failure(std::make_unique<RuntimeError>(pos_start, pos_end, "Key not found in dictionary"));
+
+            return RTResult().Success(*value);
         }
         else
         {
@@ -184,48 +614,17 @@ RTResult Interpreter::Visit_BinOpNode(BinOpNode& node)
             );
         }
     }
-    else if (std::holds_alternative<double>(l) && std::holds_alternative<double>(r))  // Other numeric operators (require numbers only)
+    else if (std::holds_alternative<List*>(l) && Helper::IsNumber(r))
     {
-        double lNum = std::get<double>(l);
-        double rNum = std::get<double>(r);
+        int64_t index = Helper::ToInt(r);
+        const auto& source = std::get<List*>(l)->elements;
 
-        if (node.GetOpToken().GetType() == TT_MINUS)
-            return RTResult().Success(lNum - rNum);
-        else if (node.GetOpToken().GetType() == TT_DIV)
-        {
-            if (rNum == 0)
-                return RTResult().Failure(std::make_unique<RuntimeError>(pos_start, pos_end, "Division by zero"));
-            return RTResult().Success(lNum / rNum);
-        }
-        else if (node.GetOpToken().GetType() == TT_POW)
-            return RTResult().Success(pow(lNum, rNum));
-        else if (node.GetOpToken().GetType() == TT_EQEQ)
-            return RTResult().Success(SymbolValue(static_cast<double>(lNum == rNum)));
-        else if (node.GetOpToken().GetType() == TT_NEQ)                                      
-            return RTResult().Success(SymbolValue(static_cast<double>(lNum != rNum)));
-        else if (node.GetOpToken().GetType() == TT_LT)                                      
-            return RTResult().Success(SymbolValue(static_cast<double>(lNum < rNum)));
-        else if (node.GetOpToken().GetType() == TT_GT)                                      
-            return RTResult().Success(SymbolValue(static_cast<double>(lNum > rNum)));
-        else if (node.GetOpToken().GetType() == TT_LTEQ)                                    
-            return RTResult().Success(SymbolValue(static_cast<double>(lNum <= rNum)));
-        else if (node.GetOpToken().GetType() == TT_GTEQ)                                   
-            return RTResult().Success(SymbolValue(static_cast<double>(lNum >= rNum)));
-        else if (node.GetOpToken().Matches(TT_KEYWORD, "AND"))                             
-            return RTResult().Success(SymbolValue(static_cast<double>(lNum && rNum)));
-        else if (node.GetOpToken().Matches(TT_KEYWORD, "OR"))                              
-            return RTResult().Success(SymbolValue(static_cast<double>(lNum || rNum)));
-    }
-    else if (std::holds_alternative<std::shared_ptr<List>>(l) && std::holds_alternative<double>(r))
-    {
-        int index = static_cast<int>(std::get<double>(r));
-        List result(std::get<std::shared_ptr<List>>(l)->elements);
-
-        if (index < 0 || index >= result.elements.size())
+        if (index < 0 || index >= static_cast<int64_t>(source.size()))
             return RTResult().Failure(std::make_unique<RuntimeError>(pos_start, pos_end, "Index out of bounce in list deletion"));
 
-        result.elements.erase(result.elements.begin() + std::get<double>(r));
-        return RTResult().Success(std::make_shared<List>(result));
+        List* result = heap.Allocate<List>(source);
+        result->elements.erase(result->elements.begin() + index);
+        return RTResult().Success(result);
     }
 
     return RTResult().Failure(std::make_unique<RuntimeError>(pos_start, pos_end, "Unsupported operand types for binary operation"));
@@ -236,15 +635,22 @@ RTResult Interpreter::Visit_UnaryOpNode(UnaryOpNode& node)
     RTResult res_num = Visit(node.GetNode());
     if (res_num.ShouldReturn()) return res_num;
 
-    double num = std::get<double>(res_num.GetValue().value());
-    std::string op_type = node.GetOpToken().GetType();
+    const SymbolValue& value = res_num.GetValue().value();
+    const std::string& op_type = node.GetOpToken().GetType();
+
+    if (!Helper::IsNumber(value))
+        return RTResult().Failure(std::make_unique<RuntimeError>(node.GetOpToken().GetPosStart(), node.GetOpToken().GetPosEnd(), "Unary operators require a number"));
 
     if (op_type == TT_MINUS)
-        return RTResult().Success(-num);
+    {
+        if (std::holds_alternative<int64_t>(value) && std::get<int64_t>(value) != INT64_MIN)
+            return RTResult().Success(-std::get<int64_t>(value));
+        return RTResult().Success(-Helper::ToDouble(value));
+    }
     if (op_type == TT_PLUS)
-        return RTResult().Success(+num);
+        return res_num;
     if (node.GetOpToken().Matches(TT_KEYWORD, "NOT"))
-        return RTResult().Success(SymbolValue(static_cast<double>(num == 0 ? 1 : 0)));
+        return RTResult().Success(static_cast<int64_t>(Helper::IsTruthy(value) ? 0 : 1));
 
     return RTResult().Failure(
         std::make_unique<RuntimeError>(
@@ -259,160 +665,353 @@ RTResult Interpreter::Visit_VarAccessNode(VarAccessNode& node)
 {
     RTResult res;
 
-    std::string varName = std::get<std::string>(node.GetVarNameToken().GetValue());
+    const std::string& varName = std::get<std::string>(node.GetVarNameToken().GetValue());
 
     // If namespaced (like Test::func1)
     if (node.IsNamespaced())
     {
-        std::string moduleAlias = node.GetModuleAlias().value();
+        const std::string& moduleAlias = node.GetModuleAlias().value();
 
-        auto it = importedModules.find(moduleAlias);
-        if (it == importedModules.end())
+        std::string error;
+        SymbolTable* moduleTable = LookupModule(node, error);
+        if (moduleTable == nullptr)
         {
-            return res.Failure(std::make_unique<RuntimeError>(node.GetPosStart(), node.GetPosEnd(), "Module '" + moduleAlias + "' not found"));
+            return res.Failure(std::make_unique<RuntimeError>(node.GetPosStart(), node.GetPosEnd(), error));
         }
 
-        auto moduleSymbols = it->second;
-        auto value = moduleSymbols->Get(varName);
-        if (!value.has_value())
+        const SymbolValue* value = LookupGlobal(*moduleTable, varName, node.GetCache());
+        if (value == nullptr)
         {
             return res.Failure(std::make_unique<RuntimeError>(node.GetPosStart(), node.GetPosEnd(), "'" + varName + "' not found in module '" + moduleAlias + "'"));
         }
 
-        return res.Success(value);
+        return res.Success(*value);
     }
 
     // Normal access
-    auto value = symbolTable.Get(varName);
+    auto value = GetVariable(node);
 
     if (!value.has_value())
         return res.Failure(std::make_unique<RuntimeError>(node.GetPosStart(), node.GetPosEnd(), "'" + varName + "' is not defined"));
 
-    if (std::holds_alternative<double>(value.value()))
-        return res.Success(std::get<double>(value.value()));
-    else if (std::holds_alternative<std::string>(value.value()))
-        return res.Success(std::get<std::string>(value.value()));
-    else if (std::holds_alternative<std::shared_ptr<List>>(value.value()))
-        return res.Success(std::get<std::shared_ptr<List>>(value.value()));
-    else if (std::holds_alternative<std::shared_ptr<BaseFunction>>(value.value()))
-        return res.Success(std::get<std::shared_ptr<BaseFunction>>(value.value()));
-    else if (std::holds_alternative<std::shared_ptr<FuncDefNode>>(value.value()))
-        return res.Success(std::get<std::shared_ptr<FuncDefNode>>(value.value()));
-    else
-        return res.Failure(std::make_unique<RuntimeError>(node.GetPosStart(), node.GetPosEnd(), "Variable is not a number, a string, a List or a Function"));
+    return res.Success(std::move(value));
 }
 
 RTResult Interpreter::Visit_VarAssignNode(VarAssignNode& node)
 {
-    std::string varName = std::get<std::string>(node.GetVarNameToken().GetValue());
+    const std::string& varName = std::get<std::string>(node.GetVarNameToken().GetValue());
     RTResult res_value = Visit(node.GetValueNode());
 
     if (res_value.ShouldReturn())
         return res_value;
 
-    if (std::holds_alternative<double>(res_value.GetValue().value()))
-        symbolTable.Set(varName, std::get<double>(res_value.GetValue().value()));
-    else if (std::holds_alternative<std::string>(res_value.GetValue().value()))
-        symbolTable.Set(varName, std::get<std::string>(res_value.GetValue().value()));
-    else if (std::holds_alternative<std::shared_ptr<List>>(res_value.GetValue().value()))
-        symbolTable.Set(varName, std::get<std::shared_ptr<List>>(res_value.GetValue().value()));
+    // Functions are values too, so "VAR sub = FUNC(a, b) -> a - b" and "VAR say = PRINTLN" work
+    SetVariable(varName, node.GetSlot(), res_value.GetValue().value(), node.GetCache());
 
-    return res_value.Success(res_value.GetValue().value());
+    return res_value;
 }
 
 RTResult Interpreter::Visit_IfNode(IfNode& node)
 {
     RTResult res;
+    const auto& cases = node.GetCases();
 
-    for (IfCase& ifCase : node.GetCases())
+    // A resumed generator continues in the case it yielded in, the conditions aren't evaluated again
+    size_t caseIndex = 0;
+    if (resuming)
+        caseIndex = TakeResumePoint().index;
+    else
     {
-        RTResult conditionValue = Visit(ifCase.GetCondition());
-        if (conditionValue.ShouldReturn())
-            return conditionValue;
-
-        if (std::get<double>(conditionValue.GetValue().value()) != 0)
+        for (; caseIndex < cases.size(); ++caseIndex)
         {
-            RTResult exprValue = Visit(ifCase.GetExpr());
-            if (exprValue.ShouldReturn())
-                return exprValue;
-
-            if (exprValue.GetValue().has_value() == false)
-                return res.Success(std::nullopt);
+            bool isTrue = false;
+            RTResult conditionValue = Visit_Condition(cases[caseIndex].GetCondition(), isTrue);
+            if (conditionValue.ShouldReturn())
+                return conditionValue;
 
-            if (!ifCase.GetShouldReturnNull())
-                return res.Success(exprValue.GetValue().value());
-            else
-                return res.Success(std::nullopt);
+            if (isTrue)
+                break;
         }
     }
 
-    if (node.GetElseCase() != nullptr)
+    if (caseIndex < cases.size())
     {
-        RTResult elseValue = Visit(node.GetElseCase());
-        if (elseValue.ShouldReturn())
-            return elseValue;
+        RTResult exprValue = Visit(cases[caseIndex].GetExpr());
+        if (exprValue.IsYield())
+            return Suspend(std::move(exprValue), { caseIndex, {}, {} });
+        if (exprValue.ShouldReturn())
+            return exprValue;
 
-        if (elseValue.GetValue().has_value() == false)
+        if (exprValue.GetValue().has_value() == false)
             return res.Success(std::nullopt);
 
-        /*if (!node.GetElseCase())
-            return res.Success(elseValue.GetValue().value());
-        else*/
+        if (!cases[caseIndex].GetShouldReturnNull())
+            return exprValue;
+        else
             return res.Success(std::nullopt);
     }
 
+    if (node.GetElseCase() != nullptr)
+    {
+        // The else case is an IfNode itself, which already drops the value of block bodies
+        res = Visit(node.GetElseCase());
+        if (res.IsYield())
+            return Suspend(std::move(res), { caseIndex, {}, {} });
+        return res;
+    }
+
     return res.Success(std::nullopt);
 }
 
+// Steps a FOR counter, an integer counter that would overflow has already passed every possible end value
+static bool StepCounter(int64_t& i, int64_t step)
+{
+    return AddInt(i, step, i);
+}
+
+static bool StepCounter(double& i, double step)
+{
+    i += step;
+    return true;
+}
+
 RTResult Interpreter::Visit_ForNode(ForNode& node)
 {
     RTResult res;
     std::vector<ListValue> elements;
+    GCRoot elementsRoot(heap, elements);
 
-    RTResult startValue = Visit(node.GetStartValueNode());
-    if (startValue.ShouldReturn())
-        return startValue;
-
-    RTResult endValue = Visit(node.GetEndValueNode());
-    if (endValue.ShouldReturn())
-        return endValue;
-
-    RTResult stepValue;
-    if (node.GetStepValueNode() != nullptr)
+    // A resumed generator continues the iteration it yielded in, with the counter it had as start
+    ResumePoint bounds;
+    const bool resumed = resuming;
+    if (resumed)
     {
-        stepValue = Visit(node.GetStepValueNode());
-        if (stepValue.ShouldReturn())
+        bounds = TakeResumePoint();
+        elements = std::move(bounds.elements);
+    }
+    else
+    {
+        RTResult startValue = Visit(node.GetStartValueNode());
+        if (startValue.ShouldReturn())
             return startValue;
+        bounds.values[0] = std::move(startValue.GetValue().value());
+
+        RTResult endValue = Visit(node.GetEndValueNode());
+        if (endValue.ShouldReturn())
+            return endValue;
+        bounds.values[1] = std::move(endValue.GetValue().value());
+
+        bounds.values[2] = int64_t(1);
+        if (node.GetStepValueNode() != nullptr)
+        {
+            RTResult stepValue = Visit(node.GetStepValueNode());
+            if (stepValue.ShouldReturn())
+                return stepValue;
+            bounds.values[2] = std::move(stepValue.GetValue().value());
+        }
     }
+
+    const SymbolValue& start = bounds.values[0];
+    const SymbolValue& end = bounds.values[1];
+    const SymbolValue& step = bounds.values[2];
+
+    if (!Helper::IsNumber(start) || !Helper::IsNumber(end) || !Helper::IsNumber(step))
+        return res.Failure(std::make_unique<RuntimeError>(node.GetPosStart(), node.GetPosEnd(), "FOR loop bounds and step have to be numbers"));
+
+    const std::string& varName = std::get<std::string>(node.GetVarNameTok().GetValue());
+    const std::shared_ptr<Node>& body = node.GetBodyNode();
+    const int slot = node.GetSlot();
+    const bool collectValues = !node.GetShouldReturnNull();
+    // Statement blocks are lists, a loop that drops its value runs them without building a list every iteration
+    ListNode* block = collectValues ? nullptr : dynamic_cast<ListNode*>(body.get());
+
+    // Runs the loop with either int64_t or double as counter. The direction is picked once per loop, so an iteration
+    // only compares the counter and steps it. Returns a result if the loop has to hand one up
+    auto runLoop = [&](auto i, auto endNum, auto stepNum, auto inRange) -> std::optional<RTResult>
+    {
+        bool resumeBody = resumed;
+        while (resumeBody || inRange(i, endNum))
+        {
+            if (!resumeBody)
+            {
+                heap.CollectIfNeeded();
+                SetVariable(varName, slot, i, node.GetCache());
+            }
+            resumeBody = false;
+
+            res = block != nullptr ? Visit_Statements(*block) : Visit(body);
+            if (res.IsYield())
+                return Suspend(std::move(res), { 0, { i, endNum, stepNum }, std::move(elements) });
+            if (res.ShouldReturn() && !res.GetLoopShouldContinue() && !res.GetLoopShouldBreak())
+                return std::move(res);
+
+            if (res.GetLoopShouldBreak())
+                break;
+
+            // Block loops evaluate to null, so there is no need to keep every iteration's value alive
+            if (collectValues && !res.GetLoopShouldContinue() && res.GetValue().has_value())
+                elements.push_back(std::move(res.GetValue().value()));
+
+            if (!StepCounter(i, stepNum))
+                break;
+        }
+        return std::nullopt;
+    };
+
+    auto runDirected = [&](auto i, auto endNum, auto stepNum)
+    {
+        if (stepNum >= 0)
+            return runLoop(i, endNum, stepNum, std::less<>());
+        return runLoop(i, endNum, stepNum, std::greater<>());
+    };
+
+    // Integer bounds keep the counter an integer, mixing in a double makes it a double loop
+    std::optional<RTResult> earlyResult;
+    if (std::holds_alternative<int64_t>(start) && std::holds_alternative<int64_t>(end) && std::holds_alternative<int64_t>(step))
+        earlyResult = runDirected(std::get<int64_t>(start), std::get<int64_t>(end), std::get<int64_t>(step));
     else
-        stepValue.SetValue(static_cast<double>(1));
+        earlyResult = runDirected(Helper::ToDouble(start), Helper::ToDouble(end), Helper::ToDouble(step));
 
-    std::function<bool(int)> condition;
+    if (earlyResult.has_value())
+        return std::move(earlyResult.value());
 
-    if (std::get<double>(stepValue.GetValue().value()) >= 0)
-        condition = [=](int i) { return i < std::get<double>(endValue.GetValue().value()); };
+    if (!node.GetShouldReturnNull())
+        return res.Success(heap.Allocate<List>(std::move(elements)));
     else
-        condition = [=](int i) { return i > std::get<double>(endValue.GetValue().value()); };
+        return res.Success(std::nullopt);
+}
 
-    for (int i = std::get<double>(startValue.GetValue().value()); condition(i); i += std::get<double>(stepValue.GetValue().value()))
+RTResult Interpreter::Visit_ForInNode(ForInNode& node)
+{
+    RTResult res;
+    std::vector<ListValue> elements;
+    GCRoot elementsRoot(heap, elements);
+
+    // A resumed generator continues the iteration it yielded in, at the position it had reached
+    RTResult iterableValue;
+    size_t position = 0;
+    std::optional<uint64_t> layout;	// Of a dictionary, when the loop started
+    const bool resumed = resuming;
+    if (resumed)
     {
-        symbolTable.Set(std::get<std::string>(node.GetVarNameTok().GetValue()), static_cast<double>(i));
+        ResumePoint point = TakeResumePoint();
+        iterableValue.Success(std::move(point.values[0]));
+        if (std::holds_alternative<int64_t>(point.values[1]))
+            layout = static_cast<uint64_t>(std::get<int64_t>(point.values[1]));
+        position = point.index;
+        elements = std::move(point.elements);
+    }
+    else
+    {
+        iterableValue = Visit(node.GetIterableNode());
+        if (iterableValue.ShouldReturn())
+            return iterableValue;
+    }
 
-        res = Visit(node.GetBodyNode());
-        if (res.ShouldReturn() && !res.GetLoopShouldContinue() && !res.GetLoopShouldBreak())
-            return res;
+    if (!iterableValue.GetValue().has_value())
+        return res.Failure(std::make_unique<RuntimeError>(node.GetPosStart(), node.GetPosEnd(), "FOR IN needs a list, dictionary, string or iterator"));
 
-        if (res.GetLoopShouldContinue())
-            continue;
+    // The loop body can drop every other reference to the iterable
+    const SymbolValue& iterable = iterableValue.GetValue().value();
+    GCRoot iterableRoot(heap, iterable);
 
-        if (res.GetLoopShouldBreak())
-            break;
+    const std::string& varName = std::get<std::string>(node.GetVarNameTok().GetValue());
+    const std::shared_ptr<Node>& body = node.GetBodyNode();
+    const int slot = node.GetSlot();
+    const bool collectValues = !node.GetShouldReturnNull();
+    ListNode* block = collectValues ? nullptr : dynamic_cast<ListNode*>(body.get());
+
+    // next produces one element at a time (Success(std::nullopt) at the end), so only the current element is alive.
+    // Returns a result if the loop has to hand one up
+    auto runLoop = [&](auto next) -> std::optional<RTResult>
+    {
+        bool resumeBody = resumed;
+        while (true)
+        {
+            if (!resumeBody)
+            {
+                heap.CollectIfNeeded();
+
+                RTResult element = next();
+                if (element.ShouldReturn())
+                    return element;
+                if (!element.GetValue().has_value())
+                    break;
+
+                SetVariable(varName, slot, element.GetValue().value(), node.GetCache());
+            }
+            resumeBody = false;
+
+            res = block != nullptr ? Visit_Statements(*block) : Visit(body);
+            if (res.IsYield())
+                return Suspend(std::move(res), { position, { iterable, layout.has_value() ? SymbolValue(static_cast<int64_t>(layout.value())) : SymbolValue() }, std::move(elements) });
+            if (res.ShouldReturn() && !res.GetLoopShouldContinue() && !res.GetLoopShouldBreak())
+                return std::move(res);
+
+            if (res.GetLoopShouldBreak())
+                break;
 
-        elements.push_back(res.GetValue().value());
+            if (collectValues && !res.GetLoopShouldContinue() && res.GetValue().has_value())
+                elements.push_back(std::move(res.GetValue().value()));
+        }
+        return std::nullopt;
+    };
+
+    // Lists and dictionaries are walked by index, so the body can append to them without invalidating the loop.
+    // The index is position, which a suspended generator saves. Erasing from a dictionary can compact its entries
+    // on the next insert, the loop can't tell where it was then and fails
+    std::optional<RTResult> earlyResult;
+    if (std::holds_alternative<List*>(iterable))
+    {
+        List* list = std::get<List*>(iterable);
+        earlyResult = runLoop([list, &position]()
+        {
+            if (position >= list->elements.size())
+                return RTResult().Success(std::nullopt);
+            return RTResult().Success(list->elements[position++]);
+        });
     }
+    else if (std::holds_alternative<Dict*>(iterable))
+    {
+        Dict* dict = std::get<Dict*>(iterable);
+        if (!layout.has_value())
+            layout = dict->GetLayout();
+        earlyResult = runLoop([dict, &position, &layout, &node]()
+        {
+            if (dict->GetLayout() != layout.value())
+                return RTResult().Failure(std::make_unique<RuntimeError>(node.GetPosStart(), node.GetPosEnd(), "Dictionary changed during iteration"));
+
+            const auto& entries = dict->GetEntries();
+            while (position < entries.size() && entries[position].erased)
+                position++;
+            if (position >= entries.size())
+                return RTResult().Success(std::nullopt);
+            return RTResult().Success(FromDictKey(entries[position++].key));
+        });
+    }
+    else if (std::holds_alternative<std::string>(iterable))
+    {
+        const std::string& text = std::get<std::string>(iterable);
+        earlyResult = runLoop([&text, &position]()
+        {
+            if (position >= text.size())
+                return RTResult().Success(std::nullopt);
+            return RTResult().Success(std::string(1, text[position++]));
+        });
+    }
+    else if (std::holds_alternative<Iterator*>(iterable))
+    {
+        Iterator* iterator = std::get<Iterator*>(iterable);
+        earlyResult = runLoop([iterator]() { return iterator->Next(); });
+    }
+    else
+        return res.Failure(std::make_unique<RuntimeError>(node.GetPosStart(), node.GetPosEnd(), "FOR IN needs a list, dictionary, string or iterator"));
+
+    if (earlyResult.has_value())
+        return std::move(earlyResult.value());
 
     if (!node.GetShouldReturnNull())
-        return res.Success(std::make_shared<List>(elements));
+        return res.Success(heap.Allocate<List>(std::move(elements)));
     else
         return res.Success(std::nullopt);
 }
@@ -421,17 +1020,34 @@ RTResult Interpreter::Visit_WhileNode(WhileNode& node)
 {
     RTResult res;
     std::vector<ListValue> elements;
+    GCRoot elementsRoot(heap, elements);
+
+    ListNode* block = node.GetShouldReturnNull() ? dynamic_cast<ListNode*>(node.GetBodyNode().get()) : nullptr;
+
+    // A resumed generator continues the iteration it yielded in, without checking the condition again
+    bool resumeBody = resuming;
+    if (resumeBody)
+        elements = std::move(TakeResumePoint().elements);
 
     while (true)
     {
-        auto condition = Visit(node.GetConditionNode());
-        if (condition.ShouldReturn())
-            return condition;
+        if (!resumeBody)
+        {
+            heap.CollectIfNeeded();
 
-        if (std::get<double>(condition.GetValue().value()) == 0)
-            break;
+            bool isTrue = false;
+            auto condition = Visit_Condition(node.GetConditionNode(), isTrue);
+            if (condition.ShouldReturn())
+                return condition;
 
-        res = Visit(node.GetBodyNode());
+            if (!isTrue)
+                break;
+        }
+        resumeBody = false;
+
+        res = block != nullptr ? Visit_Statements(*block) : Visit(node.GetBodyNode());
+        if (res.IsYield())
+            return Suspend(std::move(res), { 0, {}, std::move(elements) });
         if (res.ShouldReturn() && !res.GetLoopShouldContinue() && !res.GetLoopShouldBreak())
             return res;
 
@@ -441,131 +1057,398 @@ RTResult Interpreter::Visit_WhileNode(WhileNode& node)
         if (res.GetLoopShouldBreak())
             break;
 
-        elements.push_back(res.GetValue().value());
+        // Block loops evaluate to null, so there is no need to keep every iteration's value alive
+        if (!node.GetShouldReturnNull() && res.GetValue().has_value())
+            elements.push_back(std::move(res.GetValue().value()));
     }
 
     if (!node.GetShouldReturnNull())
-        return res.Success(std::make_shared<List>(elements));
+        return res.Success(heap.Allocate<List>(std::move(elements)));
     else
         return res.Success(std::nullopt);
 }
 
-RTResult Interpreter::Visit_FuncDefNode(FuncDefNode& node)
+RTResult Interpreter::Visit_FuncDefNode(const std::shared_ptr<FuncDefNode>& node)
 {
     RTResult res;
 
-    if (node.GetVarNameTok().has_value())
+    // A module's functions keep its table alive, the table of the program isn't owned through a shared_ptr
+    Function* function = heap.Allocate<Function>(node, globals, globals->weak_from_this().lock());
+
+    // A named FUNC is a statement, an anonymous one is an expression (VAR sub = FUNC(a, b) -> a - b)
+    if (node->GetVarNameTok().has_value())
     {
-        std::string funcName = std::get<std::string>(node.GetVarNameTok().value().GetValue());
-        symbolTable.Set(funcName, std::make_shared<FuncDefNode>(node));
+        const std::string& funcName = std::get<std::string>(node->GetVarNameTok().value().GetValue());
+        SetVariable(funcName, node->GetSlot(), function, node->GetCache());
+        return res.Success(std::nullopt);
     }
 
-    return res.Success(std::nullopt);
+    return res.Success(function);
+}
+
+// Built out of line, so the message temporaries don't enlarge the stack frames of the recursive call path
+static RTResult CallError(CallNode& node, const std::string& details)
+{
+    return RTResult().Failure(std::make_unique<RuntimeError>(node.GetPosStart(), node.GetPosEnd(), details));
 }
 
+// Pushes a call frame and restores the caller's frame and globals when the call is left
+class Interpreter::CallFrame
+{
+public:
+    CallFrame(Interpreter& interpreter, size_t size)
+        : interpreter(interpreter), base(interpreter.frames.Push(size)), callerBase(interpreter.frameBase), callerGlobals(interpreter.globals) {}
+    CallFrame(const CallFrame&) = delete;
+    CallFrame& operator=(const CallFrame&) = delete;
+    ~CallFrame()
+    {
+        interpreter.frameBase = callerBase;
+        interpreter.globals = callerGlobals;
+        interpreter.frames.Pop(base);
+    }
+
+    size_t GetBase() const { return base; }
+
+    // Replaces the frame's slots with the arguments of a tail call, which were evaluated right above the frame
+    void ReuseForTailCall(size_t size, size_t argBase, size_t argCount, SymbolTable* globals)
+    {
+        for (size_t i = 0; i < argCount; ++i)
+            interpreter.frames[base + i] = std::move(interpreter.frames[argBase + i]);
+
+        interpreter.frames.Pop(base + argCount);
+        interpreter.frames.Push(size - argCount);
+        interpreter.globals = globals;
+    }
+
+    void Enter(SymbolTable* globals)
+    {
+        interpreter.frameBase = base;
+        interpreter.globals = globals;
+    }
+
+private:
+    Interpreter& interpreter;
+    size_t base;
+    size_t callerBase;
+    SymbolTable* callerGlobals;
+};
+
 RTResult Interpreter::Visit_CallNode(CallNode& node)
 {
     RTResult res;
-    std::string funcName;
-    std::optional<std::string> moduleAlias;
     std::optional<SymbolValue> funcValue;
 
-    if (auto varAccess = dynamic_cast<VarAccessNode*>(node.GetNodeToCall().get()))
+    auto varAccess = dynamic_cast<VarAccessNode*>(node.GetNodeToCall().get());
+    if (varAccess != nullptr)
     {
-        funcName = std::get<std::string>(varAccess->GetVarNameToken().GetValue());
-        moduleAlias = varAccess->GetModuleAlias();
+        const std::string& funcName = std::get<std::string>(varAccess->GetVarNameToken().GetValue());
+        const auto& moduleAlias = varAccess->GetModuleAlias();
 
         if (moduleAlias.has_value())
         {
-            auto it = importedModules.find(*moduleAlias);
-            if (it == importedModules.end())
-                return res.Failure(std::make_unique<RuntimeError>(node.GetPosStart(), node.GetPosEnd(), "Module '" + *moduleAlias + "' not found"));
+            std::string error;
+            SymbolTable* moduleTable = LookupModule(*varAccess, error);
+            if (moduleTable == nullptr)
+                return CallError(node, error);
 
-            funcValue = it->second->Get(funcName);
+            if (const SymbolValue* value = LookupGlobal(*moduleTable, funcName, varAccess->GetCache()))
+                funcValue = *value;
         }
         else
-            funcValue = symbolTable.Get(funcName);
+            funcValue = GetVariable(*varAccess);
     }
     else
-        return res.Failure(std::make_unique<RuntimeError>(node.GetPosStart(), node.GetPosEnd(), "Invalid function name"));
+        return CallError(node, "Invalid function name");
 
+    const std::string& funcName = std::get<std::string>(varAccess->GetVarNameToken().GetValue());
     if (!funcValue.has_value())
-        return res.Failure(std::make_unique<RuntimeError>(node.GetPosStart(), node.GetPosEnd(), "Function '" + funcName + "' not found"));
+        return CallError(node, "Function '" + funcName + "' not found");
+
+    if (std::holds_alternative<Function*>(funcValue.value()))
+    {
+        // The first callee of a call site is inlined if it is small enough. The name can be rebound at any time,
+        // so the inlined body is only used while the call still reaches the same function body
+        Function* callee = std::get<Function*>(funcValue.value());
+
+        // Calling a generator function only binds the arguments, the body runs while the generator is iterated
+        if (callee->prototype->IsGenerator())
+            return CreateGenerator(node, callee);
+
+        // The inlined body runs with the caller's globals, so only calls within the same file are inlined
+        if (callee->globals == globals)
+        {
+            const std::shared_ptr<Node>& body = callee->prototype->GetBodyNode();
+            if (!node.GetInlineTried() && !isWorker)
+                node.SetInlined(body, Inliner::Inline(*callee->prototype, node));
+            if (node.GetInlined() != nullptr && node.GetInlinedFrom() == body)
+                return Visit(node.GetInlined());
+        }
+
+        if (node.IsTailCall())
+            return PrepareTailCall(node, callee);
+        return CallFunction(node, callee);
+    }
+    else if (std::holds_alternative<BaseFunction*>(funcValue.value()))
+    {
+        GCRoot funcRoot(heap, funcValue.value());
+        return CallBuiltin(node, std::get<BaseFunction*>(funcValue.value()), funcName);
+    }
+    else
+    {
+        return CallError(node, "Function '" + funcName + "' not callable");
+    }
+}
+
+// Kept apart from Visit_CallNode, so recursive calls only carry the stack frame of the path they take
+RTResult Interpreter::CallFunction(CallNode& node, Function* function)
+{
+    RTResult res;
+
+    if (node.GetArgNodes().size() != function->arity)
+        return CallError(node, "Incorrect number of arguments");
+
+    // The name of the callee can be rebound while the call runs, so the function object is kept alive by the call itself
+    SymbolValue callee = function;
+    GCRoot calleeRoot(heap, callee);
 
-    // Handle user-defined functions
-    if (std::holds_alternative<std::shared_ptr<FuncDefNode>>(funcValue.value()))
+    // The new frame sits on top of the caller's, arguments are still evaluated in the caller's frame
+    CallFrame frame(*this, function->frameSize);
+
+    for (size_t i = 0; i < node.GetArgNodes().size(); ++i)
     {
-        auto funcNodePtr = std::get<std::shared_ptr<FuncDefNode>>(funcValue.value());
+        auto argRes = Visit(node.GetArgNodes()[i]);
+        if (argRes.ShouldReturn()) return argRes;
+
+        frames[frame.GetBase() + i] = std::move(argRes.GetValue());
+    }
 
-        if (node.GetArgNodes().size() != funcNodePtr->GetArgNameToks().size())
-            return res.Failure(std::make_unique<RuntimeError>(node.GetPosStart(), node.GetPosEnd(), "Incorrect number of arguments"));
+    // Every argument is reachable from the frame stack now, so this is a safe point
+    heap.CollectIfNeeded();
 
-        // Save current symbol table
-        SymbolTable localSymbolTable(&symbolTable);
+    // Execute function body
+    frame.Enter(function->globals);
 
-        // Assign arguments
-        for (size_t i = 0; i < node.GetArgNodes().size(); ++i)
+    // Tail calls run in this frame one after another instead of nesting, which keeps tail recursion in constant stack
+    while (true)
+    {
+        auto result = Visit(function->prototype->GetBodyNode());
+        if (result.IsTailCall())
         {
-            auto argRes = Visit(node.GetArgNodes()[i]);
-            if (argRes.ShouldReturn()) return argRes;
-
-            std::string argName = std::get<std::string>(funcNodePtr->GetArgNameToks()[i].GetValue());
-            auto argResVal = argRes.GetValue().value();
-
-            if (std::holds_alternative<double>(argResVal))
-                localSymbolTable.Set(argName, std::get<double>(argResVal));
-            else if (std::holds_alternative<std::string>(argResVal))
-                localSymbolTable.Set(argName, std::get<std::string>(argResVal));
-            else if (std::holds_alternative<std::shared_ptr<List>>(argResVal))
-                localSymbolTable.Set(argName, std::get<std::shared_ptr<List>>(argResVal));
+            function = tailCall.function;
+            callee = function;
+            frame.ReuseForTailCall(function->frameSize, tailCall.argBase, function->arity, function->globals);
+            heap.CollectIfNeeded();
+            continue;
         }
 
-        // Execute function body
-        Interpreter funcInterpreter(localSymbolTable);
-        funcInterpreter.SetMainFilePath(mainFilePath);
-        auto result = funcInterpreter.Visit(funcNodePtr->GetBodyNode());
         if (result.HasError()) return result;
         if (result.GetLoopShouldBreak() || result.GetLoopShouldContinue())
-            return res.Failure(std::make_unique<RuntimeError>(node.GetPosStart(), node.GetPosEnd(), "Cannot use 'break' or 'continue' outside of a loop"));
+            return CallError(node, "Cannot use 'break' or 'continue' outside of a loop");
 
-        if (result.GetFuncReturnValue().has_value())
-            return res.Success(result.GetFuncReturnValue());
-        else if (funcNodePtr->GetShouldAutoReturn())
-            return res.Success(result.GetValue());
+        if (result.GetFuncShouldReturn())
+            return res.Success(std::move(result.GetValue()));
+        else if (function->prototype->GetShouldAutoReturn())
+            return result;
         else
             return res.Success(std::nullopt);
     }
-    // Handle built-in functions
-    else if (std::holds_alternative<std::shared_ptr<BaseFunction>>(funcValue.value()))
+}
+
+RTResult Interpreter::PrepareTailCall(CallNode& node, Function* function)
+{
+    if (node.GetArgNodes().size() != function->arity)
+        return CallError(node, "Incorrect number of arguments");
+
+    // Rooted while the arguments run, afterwards CallFunction takes over before the next safe point
+    SymbolValue callee = function;
+    GCRoot calleeRoot(heap, callee);
+
+    // The arguments still need the current frame, so they go above it until CallFunction moves them down
+    size_t argBase = frames.Push(node.GetArgNodes().size());
+
+    for (size_t i = 0; i < node.GetArgNodes().size(); ++i)
     {
-        auto func = std::get<std::shared_ptr<BaseFunction>>(funcValue.value());
+        auto argRes = Visit(node.GetArgNodes()[i]);
+        if (argRes.ShouldReturn()) return argRes;
+
+        frames[argBase + i] = std::move(argRes.GetValue());
+    }
+
+    tailCall.function = function;
+    tailCall.argBase = argBase;
+    return RTResult().SuccessTailCall();
+}
 
-        std::vector<SymbolValue> args;
-        for (auto& argNode : node.GetArgNodes())
+RTResult Interpreter::CreateGenerator(CallNode& node, Function* function)
+{
+    if (node.GetArgNodes().size() != function->arity)
+        return CallError(node, "Incorrect number of arguments");
+
+    SymbolValue callee = function;
+    GCRoot calleeRoot(heap, callee);
+
+    std::vector<SymbolValue> args;
+    GCRoot argsRoot(heap, args);
+    for (const auto& argNode : node.GetArgNodes())
+    {
+        auto argRes = Visit(argNode);
+        if (argRes.ShouldReturn()) return argRes;
+
+        if (!argRes.GetValue().has_value())
+            return CallError(node, "Unsupported argument type for generator function");
+
+        args.push_back(std::move(argRes.GetValue().value()));
+    }
+
+    Iterator* generator = heap.Allocate<Generator>(*this, function, std::move(args));
+    return RTResult().Success(generator);
+}
+
+RTResult Interpreter::CallWithArgs(Function* function, std::span<const SymbolValue> args)
+{
+    RTResult res;
+
+    // The caller keeps the arguments alive, the function is rooted here because a tail call replaces it
+    SymbolValue callee = function;
+    GCRoot calleeRoot(heap, callee);
+
+    CallFrame frame(*this, function->frameSize);
+    for (size_t i = 0; i < args.size(); ++i)
+        frames[frame.GetBase() + i] = args[i];
+
+    frame.Enter(function->globals);
+
+    while (true)
+    {
+        auto result = Visit(function->prototype->GetBodyNode());
+        if (result.IsTailCall())
         {
-            auto argRes = Visit(argNode);
-            if (argRes.ShouldReturn()) return argRes;
+            function = tailCall.function;
+            callee = function;
+            frame.ReuseForTailCall(function->frameSize, tailCall.argBase, function->arity, function->globals);
+            heap.CollectIfNeeded();
+            continue;
+        }
 
-            auto val = argRes.GetValue().value();
-            if (std::holds_alternative<double>(val) || std::holds_alternative<std::string>(val) || std::holds_alternative<std::shared_ptr<List>>(val) || std::holds_alternative<std::shared_ptr<BaseFunction>>(val) || std::holds_alternative<std::shared_ptr<FuncDefNode>>(val))
-            {
-                args.push_back(val);
-            }
-            else
-            {
-                return res.Failure(std::make_unique<RuntimeError>(node.GetPosStart(), node.GetPosEnd(), "Unsupported argument type for built-in function"));
-            }
+        if (result.HasError()) return result;
+        if (result.GetLoopShouldBreak() || result.GetLoopShouldContinue())
+            return res.Failure(std::make_unique<RuntimeError>(function->prototype->GetPosStart(), function->prototype->GetPosEnd(), "Cannot use 'break' or 'continue' outside of a loop"));
+
+        if (result.GetFuncShouldReturn())
+            return res.Success(std::move(result.GetValue()));
+        else if (function->prototype->GetShouldAutoReturn())
+            return result;
+        else
+            return res.Success(std::nullopt);
+    }
+}
+
+RTResult Interpreter::RunGenerator(Function* function, std::span<const SymbolValue> args)
+{
+    // Only a suspended body has resume points. The first run pushes the frame of the body, it stays at the bottom
+    // of this interpreter's frame stack until the generator is done
+    resuming = !resumePoints.empty();
+    if (!resuming)
+    {
+        frameBase = frames.Push(function->frameSize);
+        for (size_t i = 0; i < args.size(); ++i)
+            frames[frameBase + i] = args[i];
+        globals = function->globals;
+    }
+
+    RTResult result = Visit(function->prototype->GetBodyNode());
+    if (result.IsYield() || result.HasError())
+        return result;
+    if (result.GetLoopShouldBreak() || result.GetLoopShouldContinue())
+        return result.Failure(std::make_unique<RuntimeError>(function->prototype->GetPosStart(), function->prototype->GetPosEnd(), "Cannot use 'break' or 'continue' outside of a loop"));
+
+    // A generator produces nothing but its YIELDs, a returned value ends it like the end of the body
+    return result.Success(std::nullopt);
+}
+
+RTResult Interpreter::Suspend(RTResult&& result, ResumePoint point)
+{
+    resumePoints.push_back(std::move(point));
+    return std::move(result);
+}
+
+Interpreter::ResumePoint Interpreter::TakeResumePoint()
+{
+    ResumePoint point = std::move(resumePoints.back());
+    resumePoints.pop_back();
+    return point;
+}
+
+void Interpreter::TraceFrames(Heap& heap)
+{
+    frames.TraceRoots(heap);
+    for (const ResumePoint& point : resumePoints)
+    {
+        for (const auto& value : point.values)
+            heap.Mark(value);
+        for (const auto& element : point.elements)
+            heap.Mark(element);
+    }
+}
+
+RTResult Interpreter::CallValue(const SymbolValue& callee, std::span<const SymbolValue> args)
+{
+    RTResult res;
+
+    if (std::holds_alternative<Function*>(callee))
+    {
+        Function* function = std::get<Function*>(callee);
+        if (args.size() != function->arity)
+            return res.Failure(std::make_unique<RuntimeError>(Position(), Position(), "Incorrect number of arguments"));
+
+        if (function->prototype->IsGenerator())
+        {
+            Iterator* generator = heap.Allocate<Generator>(*this, function, std::vector<SymbolValue>(args.begin(), args.end()));
+            return res.Success(generator);
         }
 
-        auto result = func->Execute(args);
-        if (result.ShouldReturn()) return result;
+        return CallWithArgs(function, args);
+    }
 
-        return res.Success(result.GetValue());
+    if (std::holds_alternative<BaseFunction*>(callee))
+    {
+        BaseFunction* func = std::get<BaseFunction*>(callee);
+        if (func->GetArity() >= 0 && static_cast<size_t>(func->GetArity()) != args.size())
+            return res.Failure(std::make_unique<RuntimeError>(Position(), Position(), func->ToString() + " takes exactly " + std::to_string(func->GetArity()) + (func->GetArity() == 1 ? " argument" : " arguments")));
+
+        if (auto higherOrder = dynamic_cast<HigherOrderFunction*>(func))
+            return higherOrder->Call(*this, args);
+        return func->Execute(args);
     }
-    else
+
+    return res.Failure(std::make_unique<RuntimeError>(Position(), Position(), "Value is not callable"));
+}
+
+RTResult Interpreter::CallBuiltin(CallNode& node, BaseFunction* func, const std::string& funcName)
+{
+    RTResult res;
+    const auto& argNodes = node.GetArgNodes();
+
+    if (func->GetArity() >= 0 && static_cast<size_t>(func->GetArity()) != argNodes.size())
+        return CallError(node, funcName + "() takes exactly " + std::to_string(func->GetArity()) + (func->GetArity() == 1 ? " argument" : " arguments"));
+
+    ArgBuffer args(heap, argNodes.size());
+
+    for (auto& argNode : argNodes)
     {
-        return res.Failure(std::make_unique<RuntimeError>(node.GetPosStart(), node.GetPosEnd(), "Function '" + funcName + "' not callable"));
+        auto argRes = Visit(argNode);
+        if (argRes.ShouldReturn()) return argRes;
+
+        if (!argRes.GetValue().has_value())
+            return CallError(node, "Unsupported argument type for built-in function");
+
+        args.Push(std::move(argRes.GetValue().value()));
     }
+
+    // Builtins that call script functions get the interpreter to run them
+    if (auto higherOrder = dynamic_cast<HigherOrderFunction*>(func))
+        return higherOrder->Call(*this, args.Args());
+    return func->Execute(args.Args());
 }
 
 RTResult Interpreter::Visit_ReturnNode(ReturnNode& node)
@@ -578,12 +1461,111 @@ RTResult Interpreter::Visit_ReturnNode(ReturnNode& node)
         if (res.ShouldReturn())
             return res;
 
-        return res.SuccessReturn(res.GetValue().value());
+        return res.SuccessReturn(std::move(res.GetValue()));
     }
     else
         return res.SuccessReturn(std::nullopt);
 }
 
+RTResult Interpreter::Visit_YieldNode(YieldNode& node)
+{
+    RTResult res;
+
+    if (generator == nullptr)
+        return res.Failure(std::make_unique<RuntimeError>(node.GetPosStart(), node.GetPosEnd(), "YIELD can only be used inside a function"));
+
+    // The body walked back down to this YIELD, it continues after it
+    if (resuming)
+    {
+        TakeResumePoint();
+        resuming = false;
+        return res.Success(std::nullopt);
+    }
+
+    if (!node.IsResumable())
+        return res.Failure(std::make_unique<RuntimeError>(node.GetPosStart(), node.GetPosEnd(), "YIELD can't be used inside an expression, only in blocks, IF cases and loop bodies"));
+
+    res = Visit(node.GetNodeToYield());
+    if (res.ShouldReturn())
+        return res;
+
+    if (!res.GetValue().has_value())
+        return res.Failure(std::make_unique<RuntimeError>(node.GetPosStart(), node.GetPosEnd(), "YIELD needs a value"));
+
+    // Unwinds to RunGenerator, every statement on the way saves where it was
+    return Suspend(res.SuccessYield(std::move(res.GetValue().value())), {});
+}
+
+RTResult Interpreter::Visit_SpawnNode(SpawnNode& node)
+{
+    RTResult res;
+    CallNode& call = *node.GetCallNode();
+
+    res = Visit(call.GetNodeToCall());
+    if (res.ShouldReturn())
+        return res;
+
+    if (!res.GetValue().has_value())
+        return CallError(call, "SPAWN needs a function call");
+
+    SymbolValue callee = res.GetValue().value();
+    GCRoot calleeRoot(heap, callee);
+
+    size_t argCount = call.GetArgNodes().size();
+    if (std::holds_alternative<Function*>(callee))
+    {
+        if (argCount != std::get<Function*>(callee)->arity)
+            return CallError(call, "Incorrect number of arguments");
+    }
+    else if (std::holds_alternative<BaseFunction*>(callee))
+    {
+        BaseFunction* func = std::get<BaseFunction*>(callee);
+        if (func->GetArity() >= 0 && static_cast<size_t>(func->GetArity()) != argCount)
+            return CallError(call, func->ToString() + " takes exactly " + std::to_string(func->GetArity()) + (func->GetArity() == 1 ? " argument" : " arguments"));
+    }
+    else
+        return CallError(call, "SPAWN needs a function call");
+
+    std::vector<SymbolValue> args;
+    GCRoot argsRoot(heap, args);
+    for (const auto& argNode : call.GetArgNodes())
+    {
+        auto argRes = Visit(argNode);
+        if (argRes.ShouldReturn()) return argRes;
+
+        if (!argRes.GetValue().has_value())
+            return CallError(call, "Unsupported argument type for SPAWN");
+
+        args.push_back(std::move(argRes.GetValue().value()));
+    }
+
+    Handle* task = heap.Allocate<Task>(*this, callee, std::move(args));
+    return res.Success(task);
+}
+
+RTResult Interpreter::Visit_AwaitNode(AwaitNode& node)
+{
+    RTResult res = Visit(node.GetTaskNode());
+    if (res.ShouldReturn())
+        return res;
+
+    Awaitable* task = nullptr;
+    if (res.GetValue().has_value() && std::holds_alternative<Handle*>(res.GetValue().value()))
+        task = dynamic_cast<Awaitable*>(std::get<Handle*>(res.GetValue().value()));
+    if (task == nullptr)
+        return res.Failure(std::make_unique<RuntimeError>(node.GetPosStart(), node.GetPosEnd(), "AWAIT needs a task started by SPAWN or an I/O request"));
+
+    // Other tasks run meanwhile and can collect, a finished task is only kept alive by this root
+    SymbolValue taskValue = res.GetValue().value();
+    GCRoot taskRoot(heap, taskValue);
+    std::optional<SymbolValue> value;
+    std::string error;
+    if (!task->Await(value, error))
+        return res.Failure(std::make_unique<RuntimeError>(node.GetPosStart(), node.GetPosEnd(), error));
+
+    return res.Success(value);
+}
+
 RTResult Interpreter::Visit_ContinueNode(ContinueNode& node)
 {
     return RTResult().SuccessContinue();
@@ -594,105 +1576,144 @@ RTResult Interpreter::Visit_BreakNode(BreakNode& node)
     return RTResult().SuccessBreak();
 }
 
-RTResult Interpreter::Visit_ImportNode(ImportNode& node)
+std::shared_ptr<SymbolTable> Interpreter::LoadModule(std::filesystem::path filePath, std::string& error)
 {
-    RTResult res;
-
-    std::filesystem::path filePath(std::get<std::string>(node.GetFilepathToken().GetValue()));
-    std::filesystem::path MainFilePath = mainFilePath;
-
-    // If path is relative, resolve it based on importing file's directory
-    if (!filePath.is_absolute())
-        filePath = MainFilePath.parent_path().string() + "\\" + std::get<std::string>(node.GetFilepathToken().GetValue());
-
     if (!std::filesystem::exists(filePath))
-        return res.Failure(std::make_unique<RuntimeError>(node.GetPosStart(), node.GetPosEnd(), "Import file not found: " + filePath.string()));
+    {
+        error = "Import file not found: " + filePath.string();
+        return nullptr;
+    }
 
     // Normalize (e.g. resolve "..", ".")
     filePath = std::filesystem::canonical(filePath);
 
-    std::ifstream file(filePath);
-    if (!file.is_open())
-        return res.Failure(std::make_unique<RuntimeError>(node.GetPosStart(), node.GetPosEnd(), "Could not open import file: " + filePath.string()));
-
-    std::stringstream buffer;
-    buffer << file.rdbuf();
-    std::string fileContent = buffer.str();
-    file.close();
+    // A file is run once, every IMPORT of it while it is unchanged shares the module table
+    std::shared_ptr<SymbolTable> importSymbolTable = modules.Find(filePath);
+    if (importSymbolTable != nullptr)
+        return importSymbolTable;
 
-    Lexer lexer(filePath.string(), fileContent);
-    auto lexResult = lexer.MakeTokens();
-    if (lexResult.error != nullptr)
-        return res.Failure(std::make_unique<RuntimeError>(node.GetPosStart(), node.GetPosEnd(), lexResult.error->AsString()));
-
-    Parser parser(lexResult.tokens);
-    auto parseResult = parser.Parse();
-    if (parseResult.HasError())
-        return res.Failure(std::make_unique<RuntimeError>(node.GetPosStart(), node.GetPosEnd(), parseResult.GetError()));
+    if (!modules.BeginBuild(filePath))
+    {
+        error = "Circular import, " + filePath.string() + " imports itself through its imports";
+        return nullptr;
+    }
 
-    std::shared_ptr<Node> tree = parseResult.GetNode();
+    // Usually parsed already, on several threads before the program started
+    std::shared_ptr<ParsedModule> module = modules.Take(filePath);
+    if (!module->error.empty())
+    {
+        modules.EndBuild(filePath);
+        error = module->error;
+        return nullptr;
+    }
 
-    auto importSymbolTable = std::make_shared<SymbolTable>(&symbolTable);
+    // Other modules share the table, so it sees the program's globals and not those of whoever imported it first
+    importSymbolTable = std::make_shared<SymbolTable>(&symbolTable.GetRoot());
 
-    Interpreter importInterpreter(*importSymbolTable);
+    Interpreter importInterpreter(*importSymbolTable, scheduler, modules);
     importInterpreter.SetMainFilePath(filePath.string());
-    RTResult importResult = importInterpreter.Visit(tree);
+    RTResult importResult = importInterpreter.Visit(module->tree);
+    modules.EndBuild(filePath);
     if (importResult.HasError())
-        return res.Failure(std::make_unique<RuntimeError>(node.GetPosStart(), node.GetPosEnd(), importResult.GetError()));
+    {
+        error = importResult.GetError();
+        return nullptr;
+    }
+
+    modules.Add(filePath, *module, importSymbolTable);
+    return importSymbolTable;
+}
+
+RTResult Interpreter::Visit_ImportNode(ImportNode& node)
+{
+    RTResult res;
+
+    if (isWorker)
+        return res.Failure(std::make_unique<RuntimeError>(node.GetPosStart(), node.GetPosEnd(), "IMPORT can't be used inside PARALLEL_MAP or PARALLEL_FOR"));
+
+    std::filesystem::path filePath = ModuleLoader::Resolve(std::get<std::string>(node.GetFilepathToken().GetValue()), mainFilePath);
+
+    // Only the alias is registered, LookupModule loads the module on the first access through it
+    if (node.IsLazy())
+    {
+        if (!std::filesystem::exists(filePath))
+            return res.Failure(std::make_unique<RuntimeError>(node.GetPosStart(), node.GetPosEnd(), "Import file not found: " + filePath.string()));
 
-    importedModules[node.GetAlias()] = importSymbolTable;
+        SymbolTable::ModuleAliases& aliases = globals->GetModuleAliases();
+        aliases.imported.erase(node.GetAlias());
+        aliases.lazy[node.GetAlias()] = filePath;
+        aliases.generation = SymbolTable::NextModulesGeneration();
+        return res.Success(std::nullopt);
+    }
+
+    std::string error;
+    std::shared_ptr<SymbolTable> importSymbolTable = LoadModule(filePath, error);
+    if (importSymbolTable == nullptr)
+        return res.Failure(std::make_unique<RuntimeError>(node.GetPosStart(), node.GetPosEnd(), error));
+
+    SymbolTable::ModuleAliases& aliases = globals->GetModuleAliases();
+    aliases.lazy.erase(node.GetAlias());
+    aliases.imported[node.GetAlias()] = importSymbolTable;
+    aliases.generation = SymbolTable::NextModulesGeneration();
 
     return res.Success(std::nullopt);
 }
 
-RTResult& RTResult::Success(std::optional<SymbolValue> value)
+RTResult&& RTResult::Success(std::optional<SymbolValue> value)
 {
     Reset();
-    this->value = value;
-    return *this;
+    this->value = std::move(value);
+    return std::move(*this);
 }
 
-RTResult& RTResult::SuccessReturn(std::optional<SymbolValue> value)
+RTResult&& RTResult::SuccessReturn(std::optional<SymbolValue> value)
 {
     Reset();
-    this->funcReturnValue = value;
-    return *this;
+    this->value = std::move(value);
+    status = ResultStatus::Return;
+    return std::move(*this);
 }
 
-RTResult& RTResult::SuccessContinue()
+RTResult&& RTResult::SuccessContinue()
 {
     Reset();
-    loopShouldContinue = true;
-    return *this;
+    status = ResultStatus::Continue;
+    return std::move(*this);
 }
 
-RTResult& RTResult::SuccessBreak()
+RTResult&& RTResult::SuccessBreak()
 {
     Reset();
-    loopShouldBreak = true;
-    return *this;
+    status = ResultStatus::Break;
+    return std::move(*this);
 }
 
-RTResult& RTResult::Failure(std::unique_ptr<Error> error)
+RTResult&& RTResult::SuccessTailCall()
 {
     Reset();
-    this->error = std::move(error);
-    return *this;
+    status = ResultStatus::TailCall;
+    return std::move(*this);
 }
 
-bool RTResult::ShouldReturn()
+RTResult&& RTResult::SuccessYield(SymbolValue value)
 {
-    if (error != nullptr || funcReturnValue.has_value() || loopShouldContinue || loopShouldBreak)
-        return true;
-    else
-        return false;
+    Reset();
+    this->value = std::move(value);
+    status = ResultStatus::Yield;
+    return std::move(*this);
+}
+
+RTResult&& RTResult::Failure(std::unique_ptr<Error> error)
+{
+    Reset();
+    this->error = std::move(error);
+    status = ResultStatus::Error;
+    return std::move(*this);
 }
 
 void RTResult::Reset()
 {
     error = nullptr;
     value = std::nullopt;
-    funcReturnValue = std::nullopt;
-    loopShouldContinue = false;
-    loopShouldBreak = false;
-}
+    status = ResultStatus::Ok;
+}
\ No newline at end of file
@@ -4,144 +4,325 @@
 #include "Token.hpp"
 #include "Error.hpp"
 #include <unordered_map>
+#include <atomic>
+#include <filesystem>
 #include "BuildInFunctions.hpp"
+#include "Heap.hpp"
 
-struct List;
-class BaseFunction;
-using ListValue = std::variant<double, std::string, std::shared_ptr<FuncDefNode>, std::shared_ptr<List>, std::shared_ptr<BaseFunction>>;
-using SymbolValue = std::variant<double, std::string, std::shared_ptr<FuncDefNode>, std::shared_ptr<List>, std::shared_ptr<BaseFunction>>;
-
-struct List
-{
-	std::vector<ListValue> elements;
-
-	List(std::vector<ListValue> elements) : elements(elements) {}
-};
-
-class SymbolTable
+// Tables of imported modules are owned through shared_ptr, so functions defined in them can keep them alive
+class SymbolTable : public RootProvider, public std::enable_shared_from_this<SymbolTable>
 {
 public:
-	SymbolTable() = default;
-	SymbolTable(SymbolTable* parent) : parent(parent) {}
+	SymbolTable(Heap& heap) : heap(heap), id(NextId()) { heap.AddRootProvider(this); }
+	SymbolTable(SymbolTable* parent) : heap(parent->heap), parent(parent), id(NextId()) { heap.AddRootProvider(this); }
+	SymbolTable(const SymbolTable&) = delete;
+	SymbolTable& operator=(const SymbolTable&) = delete;
+	~SymbolTable() { heap.RemoveRootProvider(this); }
 
-	void Set(const std::string& name, const SymbolValue& value)
+	// Returns the index of the variable in this table, indices stay valid for the lifetime of the table
+	size_t Set(const std::string& name, const SymbolValue& value)
 	{
-		symbols[name] = value;
+		auto it = indices.find(name);
+		if (it != indices.end())
+		{
+			values[it->second] = value;
+			return it->second;
+		}
+
+		indices.emplace(name, values.size());
+		values.push_back(value);
+		version++;
+		return values.size() - 1;
 	}
 
 	std::optional<SymbolValue> Get(const std::string& name) const
 	{
-		auto it = symbols.find(name);
-		if (it != symbols.end())
-			return it->second;
+		auto it = indices.find(name);
+		if (it != indices.end())
+			return values[it->second];
 		if (parent != nullptr)
 			return parent->Get(name);
 		return std::nullopt;
 	}
 
+	// Like Get, but reports where the variable lives, so the caller can cache it
+	bool Find(const std::string& name, SymbolTable*& owner, size_t& index)
+	{
+		auto it = indices.find(name);
+		if (it != indices.end())
+		{
+			owner = this;
+			index = it->second;
+			return true;
+		}
+		if (parent != nullptr)
+			return parent->Find(name, owner, index);
+		return false;
+	}
+
+	SymbolValue& ValueAt(size_t index) { return values[index]; }
+
+	// Aliases of the IMPORTs a file ran, kept with the globals of the file, so its functions resolve Alias::name
+	// through them wherever they are called from
+	struct ModuleAliases
+	{
+		std::unordered_map<std::string, std::shared_ptr<SymbolTable>> imported;
+		std::unordered_map<std::string, std::filesystem::path> lazy;	// LAZY IMPORTs whose module wasn't used yet
+		uint64_t generation;	// Changes with every import, module tables cached on nodes are only valid for the same one
+	};
+	// Null while the file didn't import anything. Only IMPORT creates them, PARALLEL_MAP workers look them up
+	ModuleAliases* FindModuleAliases() { return moduleAliases.get(); }
+	ModuleAliases& GetModuleAliases()
+	{
+		if (moduleAliases == nullptr)
+			moduleAliases = std::make_unique<ModuleAliases>(ModuleAliases{ {}, {}, NextModulesGeneration() });
+		return *moduleAliases;
+	}
+	static uint64_t NextModulesGeneration()
+	{
+		static std::atomic<uint64_t> nextGeneration = 1;
+		return nextGeneration++;
+	}
+
+	uint64_t GetId() const { return id; }
+	// Changes whenever a name is added to this table or one of its parents, a cached lookup is valid as long as it doesn't
+	uint64_t GetChainVersion() const { return parent == nullptr ? version : version + parent->GetChainVersion(); }
+
+	Heap& GetHeap() { return heap; }
+	// The table of the program, its parent is the end of every chain
+	SymbolTable& GetRoot() { return parent == nullptr ? *this : parent->GetRoot(); }
+
+	void TraceRoots(Heap& heap) override
+	{
+		for (const auto& value : values)
+			heap.Mark(value);
+	}
+
 private:
-	std::unordered_map<std::string, SymbolValue> symbols;
+	Heap& heap;
+	std::unordered_map<std::string, size_t> indices;
+	std::vector<SymbolValue> values;
 	SymbolTable* parent = nullptr;
+	uint64_t id;
+	uint64_t version = 0;
+	std::unique_ptr<ModuleAliases> moduleAliases;	// Only for the globals of a file that imports
+
+	static uint64_t NextId()
+	{
+		static std::atomic<uint64_t> nextId = 1;
+		return nextId++;
+	}
+};
+
+enum class ResultStatus : uint8_t
+{
+	Ok,
+	Return,
+	Continue,
+	Break,
+	TailCall,	// The function has to be left and the interpreter's pending tail call executed in its frame
+	Yield,	// A generator body yielded the value, it unwinds to Interpreter::RunGenerator and saves where it was on the way
+	Error
 };
 
+// Move-only: a result is produced by exactly one Visit and handed up, never duplicated
 class RTResult
 {
 public:
 	RTResult() = default;
+	RTResult(RTResult&&) noexcept = default;
+	RTResult& operator=(RTResult&&) noexcept = default;
+	RTResult(const RTResult&) = delete;
+	RTResult& operator=(const RTResult&) = delete;
 
-	RTResult(const RTResult& other)
-	{
-		if (other.error)
-		{
-			error = std::make_unique<Error>(*other.error);
-		}
-		value = other.value;
-		funcReturnValue = other.funcReturnValue;
-		loopShouldContinue = other.loopShouldContinue;
-		loopShouldBreak = other.loopShouldBreak;
-	}
-
-	RTResult& operator=(const RTResult& other)
-	{
-		if (this != &other)
-		{
-			if (other.error)
-			{
-				error = std::make_unique<Error>(*other.error);
-			}
-			else
-			{
-				error.reset();
-			}
-
-			value = other.value;
-			funcReturnValue = other.funcReturnValue;
-			loopShouldContinue = other.loopShouldContinue;
-			loopShouldBreak = other.loopShouldBreak;
-		}
-		return *this;
-	}
-	RTResult& Success(std::optional<SymbolValue> value);
-	RTResult& SuccessReturn(std::optional<SymbolValue> value);
-	RTResult& SuccessContinue();
-	RTResult& SuccessBreak();
+	RTResult&& Success(std::optional<SymbolValue> value);
+	RTResult&& SuccessReturn(std::optional<SymbolValue> value);
+	RTResult&& SuccessContinue();
+	RTResult&& SuccessBreak();
+	RTResult&& SuccessTailCall();
+	RTResult&& SuccessYield(SymbolValue value);
 
-	RTResult& Failure(std::unique_ptr<Error> error);
+	RTResult&& Failure(std::unique_ptr<Error> error);
 
-	bool ShouldReturn();
+	bool ShouldReturn() const { return status != ResultStatus::Ok; }
 
 	void Reset();
 
-	bool HasError() const { return error != nullptr; }
+	ResultStatus GetStatus() const { return status; }
+
+	bool HasError() const { return status == ResultStatus::Error; }
 	std::string GetError() const { return error->AsString(); }
 
-	std::optional<SymbolValue> GetValue() const { return value; }
-	void SetValue(std::optional<SymbolValue> v) { value = v; }
+	// For Ok results this is the value of the expression, for Return results the returned value
+	const std::optional<SymbolValue>& GetValue() const { return value; }
+	std::optional<SymbolValue>& GetValue() { return value; }
+
+	bool GetFuncShouldReturn() const { return status == ResultStatus::Return; }
+	bool GetLoopShouldContinue() const { return status == ResultStatus::Continue; }
+	bool GetLoopShouldBreak() const { return status == ResultStatus::Break; }
+	bool IsTailCall() const { return status == ResultStatus::TailCall; }
+	bool IsYield() const { return status == ResultStatus::Yield; }
+
+private:
+	std::optional<SymbolValue> value = std::nullopt;
+	std::unique_ptr<Error> error = nullptr;
+	ResultStatus status = ResultStatus::Ok;
+};
+
+// Parameter and local variable slots of every active user function call. A call pushes one frame of
+// FuncDefNode::GetFrameSize() slots on top, empty slots are variables that haven't been assigned yet
+class FrameStack : public RootProvider
+{
+public:
+	// A generator's frames aren't a root, the generator traces them while it is reachable
+	FrameStack(Heap& heap, bool isRoot = true) : heap(heap), isRoot(isRoot)
+	{
+		if (isRoot)
+			heap.AddRootProvider(this);
+	}
+	FrameStack(const FrameStack&) = delete;
+	FrameStack& operator=(const FrameStack&) = delete;
+	~FrameStack()
+	{
+		if (isRoot)
+			heap.RemoveRootProvider(this);
+	}
 
-	std::optional<SymbolValue> GetFuncReturnValue() { return funcReturnValue; }
-	void SetFuncReturnValue(std::optional<SymbolValue> v) { funcReturnValue = v; }
+	// Returns the base index of the new frame. Slots are addressed by index, pushing can move them
+	size_t Push(size_t size)
+	{
+		size_t base = slots.size();
+		slots.resize(base + size);
+		return base;
+	}
+	void Pop(size_t base) { slots.resize(base); }
 
-	bool GetLoopShouldContinue() { return loopShouldContinue; }
-	void SetLoopShouldContinue(bool v) { loopShouldContinue = v; }
+	std::optional<SymbolValue>& operator[](size_t index) { return slots[index]; }
 
-	bool GetLoopShouldBreak() { return loopShouldBreak; }
-	void SetLoopShouldBreak(bool v) { loopShouldBreak = v; }
+	void TraceRoots(Heap& heap) override
+	{
+		for (const auto& slot : slots)
+		{
+			if (slot.has_value())
+				heap.Mark(slot.value());
+		}
+	}
 
 private:
-	std::unique_ptr<Error> error = nullptr;
-	std::optional<SymbolValue> value = std::nullopt;
-	std::optional<SymbolValue> funcReturnValue = std::nullopt;
-	bool loopShouldContinue = false;
-	bool loopShouldBreak = false;
+	Heap& heap;
+	std::vector<std::optional<SymbolValue>> slots;
+	bool isRoot;
 };
 
+class Generator;
+class Scheduler;
+class ModuleLoader;
+
 class Interpreter
 {
 public:
-	Interpreter(SymbolTable& symbolTable) : symbolTable(symbolTable) {}
+	Interpreter(SymbolTable& symbolTable, Scheduler& scheduler, ModuleLoader& modules) : symbolTable(symbolTable), heap(symbolTable.GetHeap()), scheduler(scheduler), modules(modules), globals(&symbolTable), frames(symbolTable.GetHeap()) {}
+	// Runs code for another interpreter, the body of a generator or a PARALLEL_MAP worker. It sees the same file,
+	// imported modules and globals as its creator. A worker only reads the caches on the nodes, which other
+	// workers run at the same time, and a generator inherits that from its creator
+	Interpreter(const Interpreter& creator, Generator* generator, bool isWorker = false)
+		: symbolTable(creator.symbolTable), heap(creator.heap), scheduler(creator.scheduler), modules(creator.modules), mainFilePath(creator.mainFilePath),
+		  globals(creator.globals), frames(creator.heap, generator == nullptr), generator(generator),
+		  isWorker(isWorker || creator.isWorker) {}
 
 	void SetMainFilePath(std::string mainFilePath) { this->mainFilePath = mainFilePath; }
+	Heap& GetHeap() { return heap; }
+	Scheduler& GetScheduler() { return scheduler; }
+	bool IsWorker() const { return isWorker; }
+
+	RTResult Visit(const std::shared_ptr<Node>& node);
 
-	RTResult Visit(std::shared_ptr<Node> node);
+	// Calls a function with arguments that are already evaluated (generator bodies, builtins like MEMOIZE).
+	// The caller keeps args alive. CallValue also takes builtins and creates generators, CallWithArgs runs the body
+	RTResult CallValue(const SymbolValue& callee, std::span<const SymbolValue> args);
+	RTResult CallWithArgs(Function* function, std::span<const SymbolValue> args);
+	// Runs the body of this interpreter's generator from its start or from the YIELD it was suspended at, up to
+	// the next YIELD (a Yield result with the value) or its end
+	RTResult RunGenerator(Function* function, std::span<const SymbolValue> args);
+	// Marks the frames and the saved state of a suspended generator body
+	void TraceFrames(Heap& heap);
 
 private:
 	SymbolTable& symbolTable;
+	Heap& heap;
+	Scheduler& scheduler;
+	ModuleLoader& modules;
 	std::string mainFilePath = "";
-	std::unordered_map<std::string, std::shared_ptr<SymbolTable>> importedModules;
+
+	// Globals of the running function, the module table while a function of an imported module runs
+	SymbolTable* globals;
+	FrameStack frames;
+	size_t frameBase = 0;
+
+	class CallFrame;
+
+	// Set by a tail call before it unwinds to CallFunction, the arguments are on the frame stack starting at argBase
+	struct PendingTailCall
+	{
+		Function* function = nullptr;
+		size_t argBase = 0;
+	};
+	PendingTailCall tailCall;
+
+	// The generator whose body this interpreter runs, YIELD is only valid inside one
+	Generator* generator = nullptr;
+	bool isWorker = false;
+
+	// What a statement of a suspended generator body needs to continue where it was: the element of a block, the
+	// case of an IF, or the counter, bounds or iterable and the collected values of a loop
+	struct ResumePoint
+	{
+		size_t index = 0;
+		SymbolValue values[3];
+		std::vector<SymbolValue> elements;
+	};
+	// Pushed while a YIELD unwinds, innermost first. Resuming walks back down from the outermost, resuming is set
+	// until the YIELD is reached again
+	std::vector<ResumePoint> resumePoints;
+	bool resuming = false;
+
+	RTResult Suspend(RTResult&& result, ResumePoint point);
+	ResumePoint TakeResumePoint();
+
+	std::optional<SymbolValue> GetVariable(VarAccessNode& node);
+	void SetVariable(const std::string& name, int slot, const SymbolValue& value, VariableCache& cache);
+	const SymbolValue* LookupGlobal(SymbolTable& table, const std::string& name, VariableCache& cache);
+	// Loads the module of a LAZY IMPORT on its first use, nullptr with the error message if that or the lookup fails
+	SymbolTable* LookupModule(VarAccessNode& node, std::string& error);
+	// Builds the module of an IMPORT, or shares the table built before. nullptr with the error message if it fails
+	std::shared_ptr<SymbolTable> LoadModule(std::filesystem::path filePath, std::string& error);
 
 	RTResult Visit_NumberNode(NumberNode& node);
 	RTResult Visit_StringNode(StringNode& node);
 	RTResult Visit_ListNode(ListNode& node);
+	RTResult Visit_DictNode(DictNode& node);
+	RTResult Visit_Statements(ListNode& node);
 	RTResult Visit_BinOpNode(BinOpNode& node);
+	RTResult Visit_LogicalNode(BinOpNode& node, bool& isTrue);
+	RTResult Visit_LogicalOperand(BinOpNode& node, const std::shared_ptr<Node>& operand, bool& isTrue);
+	RTResult Visit_Condition(const std::shared_ptr<Node>& node, bool& isTrue);
 	RTResult Visit_VarAccessNode(VarAccessNode& node);
 	RTResult Visit_VarAssignNode(VarAssignNode& node);
 	RTResult Visit_UnaryOpNode(UnaryOpNode& node);
 	RTResult Visit_IfNode(IfNode& node);
 	RTResult Visit_ForNode(ForNode& node);
+	RTResult Visit_ForInNode(ForInNode& node);
 	RTResult Visit_WhileNode(WhileNode& node);
-	RTResult Visit_FuncDefNode(FuncDefNode& node);
+	RTResult Visit_FuncDefNode(const std::shared_ptr<FuncDefNode>& node);
 	RTResult Visit_CallNode(CallNode& node);
+	RTResult CallFunction(CallNode& node, Function* function);
+	RTResult PrepareTailCall(CallNode& node, Function* function);
+	RTResult CreateGenerator(CallNode& node, Function* function);
+	RTResult CallBuiltin(CallNode& node, BaseFunction* func, const std::string& funcName);
 	RTResult Visit_ReturnNode(ReturnNode& node);
+	RTResult Visit_YieldNode(YieldNode& node);
+	RTResult Visit_SpawnNode(SpawnNode& node);
+	RTResult Visit_AwaitNode(AwaitNode& node);
 	RTResult Visit_ContinueNode(ContinueNode& node);
 	RTResult Visit_BreakNode(BreakNode& node);
 	RTResult Visit_ImportNode(ImportNode& node);
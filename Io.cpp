@@ -0,0 +1,129 @@
+#include "Io.hpp"
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+
+#ifdef _WIN32
+#define popen _popen
+#define pclose _pclose
+#else
+#include <sys/wait.h>
+#endif
+
+IoRequest::IoRequest(Heap& heap, Scheduler& scheduler, Operation operation) : Awaitable(scheduler), heap(heap)
+{
+    heap.AddRootProvider(this);
+    scheduler.StartExternal();
+    thread = std::thread([this, operation = std::move(operation)] { Run(operation); });
+}
+
+IoRequest::~IoRequest()
+{
+    // Only finished requests are collected
+    if (thread.joinable())
+        thread.join();
+}
+
+void IoRequest::Run(Operation operation)
+{
+    std::optional<SymbolValue> result;
+    std::string message;
+    bool ok = operation(result, message);
+
+    // The outcome is published on the program's thread, like the end of a task
+    scheduler.Post([this, ok, result = std::move(result), message = std::move(message)]() mutable
+    {
+        if (ok)
+            value = std::move(result);
+        else
+            error = std::move(message);
+        heap.RemoveRootProvider(this);
+
+        finished = true;
+        scheduler.Finished(awaiters);
+    });
+}
+
+IoRequest::Operation IoRequest::ReadFile(std::string path)
+{
+    return [path = std::move(path)](std::optional<SymbolValue>& value, std::string& error)
+    {
+        std::ifstream file(path, std::ios::binary);
+        if (!file.is_open())
+        {
+            error = "Could not open file '" + path + "'";
+            return false;
+        }
+
+        std::stringstream buffer;
+        buffer << file.rdbuf();
+        value = buffer.str();
+        return true;
+    };
+}
+
+IoRequest::Operation IoRequest::WriteFile(std::string path, std::string text)
+{
+    return [path = std::move(path), text = std::move(text)](std::optional<SymbolValue>&, std::string& error)
+    {
+        std::ofstream file(path, std::ios::binary);
+        if (!file.is_open() || !file.write(text.data(), text.size()))
+        {
+            error = "Could not write file '" + path + "'";
+            return false;
+        }
+        return true;
+    };
+}
+
+IoRequest::Operation IoRequest::RunCommand(std::string command)
+{
+    return [command = std::move(command)](std::optional<SymbolValue>& value, std::string& error)
+    {
+        FILE* pipe = popen(command.c_str(), "r");
+        if (pipe == nullptr)
+        {
+            error = "Could not run '" + command + "'";
+            return false;
+        }
+
+        std::string output;
+        char buffer[4096];
+        size_t read;
+        while ((read = fread(buffer, 1, sizeof(buffer), pipe)) > 0)
+            output.append(buffer, read);
+        int status = pclose(pipe);
+        if (status == -1)
+        {
+            error = "Could not run '" + command + "'";
+            return false;
+        }
+#ifndef _WIN32
+        // pclose gives the wait status, the exit code is only part of it
+        if (!WIFEXITED(status))
+        {
+            error = "'" + command + "' was killed by signal " + std::to_string(WTERMSIG(status));
+            return false;
+        }
+        status = WEXITSTATUS(status);
+#endif
+        if (status != 0)
+        {
+            error = "'" + command + "' failed with exit code " + std::to_string(status);
+            return false;
+        }
+
+        value = std::move(output);
+        return true;
+    };
+}
+
+IoRequest::Operation IoRequest::Timer(int64_t milliseconds)
+{
+    return [milliseconds](std::optional<SymbolValue>&, std::string&)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(milliseconds));
+        return true;
+    };
+}
\ No newline at end of file
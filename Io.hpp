@@ -0,0 +1,40 @@
+#pragma once
+#include <functional>
+#include <thread>
+#include "Task.hpp"
+
+// Result of READ_FILE, WRITE_FILE, RUN and TIMER. The operation blocks a thread of its own instead of the script,
+// so any number of them are underway at once and AWAIT gives the outcome. Like a task, a pending request is a
+// root and counts as running, the program waits for it and a script waiting only on requests isn't a deadlock
+class IoRequest : public Awaitable, public RootProvider
+{
+public:
+	// Runs on the request's thread next to the script, so it must not touch the heap. Strings and numbers are fine
+	using Operation = std::function<bool(std::optional<SymbolValue>& value, std::string& error)>;
+
+	IoRequest(Heap& heap, Scheduler& scheduler, Operation operation);
+	IoRequest(const IoRequest&) = delete;
+	IoRequest& operator=(const IoRequest&) = delete;
+	~IoRequest() override;
+
+	std::string ToString() const override { return "<request>"; }
+	void TraceRoots(Heap& heap) override { heap.Mark(this); }
+	size_t Size() const override { return sizeof(IoRequest) + threadCost; }
+
+	static Operation ReadFile(std::string path);
+	static Operation WriteFile(std::string path, std::string text);
+	// Runs command in the shell, the value is everything it wrote to stdout. Fails if the command exits with another
+	// code than 0
+	static Operation RunCommand(std::string command);
+	static Operation Timer(int64_t milliseconds);
+
+private:
+	// Stands in for the stack of the thread, so finished requests that are dropped trigger collections (which
+	// join their threads) long before the threads pile up
+	static constexpr size_t threadCost = 64 * 1024;
+
+	Heap& heap;
+	std::thread thread;
+
+	void Run(Operation operation);
+};
\ No newline at end of file
@@ -0,0 +1,85 @@
+#include "Iterator.hpp"
+
+RTResult Range::Next()
+{
+    if (done)
+        return RTResult().Success(std::nullopt);
+
+    // NativeRange makes the bounds either all integers or all doubles
+    if (std::holds_alternative<int64_t>(current))
+    {
+        int64_t i = std::get<int64_t>(current);
+        int64_t endNum = std::get<int64_t>(end);
+        int64_t stepNum = std::get<int64_t>(step);
+        if (stepNum > 0 ? i >= endNum : i <= endNum)
+        {
+            done = true;
+            return RTResult().Success(std::nullopt);
+        }
+
+        // A step that would overflow has already passed every possible end
+        if ((stepNum > 0 && i > INT64_MAX - stepNum) || (stepNum < 0 && i < INT64_MIN - stepNum))
+            done = true;
+        else
+            current = i + stepNum;
+        return RTResult().Success(i);
+    }
+
+    double i = std::get<double>(current);
+    double endNum = std::get<double>(end);
+    double stepNum = std::get<double>(step);
+    if (stepNum > 0 ? i >= endNum : i <= endNum)
+    {
+        done = true;
+        return RTResult().Success(std::nullopt);
+    }
+
+    current = i + stepNum;
+    return RTResult().Success(i);
+}
+
+Generator::Generator(Interpreter& creator, Function* function, std::vector<SymbolValue> args)
+    : interpreter(std::make_unique<Interpreter>(creator, this)), function(function), args(std::move(args))
+{
+}
+
+RTResult Generator::Next()
+{
+    if (state == State::Finished)
+        return RTResult().Success(std::nullopt);
+
+    if (state == State::Running)
+        return RTResult().Failure(std::make_unique<RuntimeError>(Position(), Position(), "Generator is already running"));
+
+    state = State::Running;
+    RTResult result = interpreter->RunGenerator(function, args);
+
+    if (result.IsYield())
+    {
+        state = State::Suspended;
+        return RTResult().Success(std::move(result.GetValue()));
+    }
+
+    // Nothing of the call is needed anymore, a finished generator only answers with the end
+    state = State::Finished;
+    interpreter.reset();
+    args.clear();
+    return result;
+}
+
+std::string Generator::ToString() const
+{
+    const auto& name = function->prototype->GetVarNameTok();
+    return "<generator '" + (name.has_value() ? std::get<std::string>(name.value().GetValue()) : std::string("<anonymous>")) + "'>";
+}
+
+void Generator::Trace(Heap& heap)
+{
+    heap.Mark(function);
+    for (const auto& arg : args)
+        heap.Mark(arg);
+
+    // While suspended, everything the body holds is on its frames and its resume points
+    if (interpreter != nullptr)
+        interpreter->TraceFrames(heap);
+}
\ No newline at end of file
@@ -0,0 +1,61 @@
+#pragma once
+#include <vector>
+#include <memory>
+#include "Interpreter.hpp"
+
+// Produces values one at a time, consumed by FOR x IN. Nothing is materialised, so an iterator over a
+// large or endless sequence only ever holds the current element
+class Iterator : public GCObject
+{
+public:
+	// Success with the next value, Success(std::nullopt) once the iterator is exhausted
+	virtual RTResult Next() = 0;
+	virtual std::string ToString() const = 0;
+};
+
+// Numbers from start up to (not including) end, RANGE(end), RANGE(start, end) and RANGE(start, end, step)
+class Range : public Iterator
+{
+public:
+	Range(SymbolValue start, SymbolValue end, SymbolValue step) : current(std::move(start)), end(std::move(end)), step(std::move(step)) {}
+
+	RTResult Next() override;
+	std::string ToString() const override { return "<range>"; }
+	size_t Size() const override { return sizeof(Range); }
+
+private:
+	SymbolValue current;
+	SymbolValue end;
+	SymbolValue step;
+	bool done = false;
+};
+
+// Suspended call of a FUNC whose body contains YIELD. Every Next runs the body on the caller's stack up to the
+// next YIELD, which unwinds back to Next. The statements it unwinds through save where they were (see
+// Interpreter::ResumePoint) and the next run walks back down to it, so a generator needs no thread or stack of its own
+class Generator : public Iterator
+{
+public:
+	Generator(Interpreter& creator, Function* function, std::vector<SymbolValue> args);
+	Generator(const Generator&) = delete;
+	Generator& operator=(const Generator&) = delete;
+
+	RTResult Next() override;
+	std::string ToString() const override;
+	void Trace(Heap& heap) override;
+	size_t Size() const override { return sizeof(Generator) + sizeof(Interpreter) + args.capacity() * sizeof(SymbolValue); }
+
+private:
+	enum class State : uint8_t
+	{
+		Created,
+		Running,
+		Suspended,
+		Finished
+	};
+
+	std::unique_ptr<Interpreter> interpreter;
+	Function* function;
+	std::vector<SymbolValue> args;
+	State state = State::Created;
+};
\ No newline at end of file
@@ -1,6 +1,7 @@
 #include "Lexer.hpp"
 #include <string>
 #include <unordered_map>
+#include <stdexcept>
 
 Lexer::Lexer(const std::string& fn, const std::string& text)
 {
@@ -130,6 +131,10 @@ MakeTokensResult Lexer::MakeTokens()
 				tokens.push_back(Token(TT_AT, std::nullopt, pos));
 				Advance();
 				break;
+			case '{':
+				tokens.push_back(Token(TT_LCURLYBRACKET, std::nullopt, pos));
+				Advance();
+				break;
 			case '}':
 				tokens.push_back(Token(TT_RCURLYBRACKET, std::nullopt, pos));
 				Advance();
@@ -176,7 +181,17 @@ Token Lexer::makeNumber()
 	//std::cout << numStr << std::endl;
 	
 	if (dotCount == 0)
-		return Token(TT_INT, std::stod(numStr), posStart, pos);
+	{
+		// Literals that don't fit into 64 bits become floats instead of failing
+		try
+		{
+			return Token(TT_INT, static_cast<int64_t>(std::stoll(numStr)), posStart, pos);
+		}
+		catch (const std::out_of_range&)
+		{
+			return Token(TT_FLOAT, std::stod(numStr), posStart, pos);
+		}
+	}
 	else
 		return Token(TT_FLOAT, std::stod(numStr), posStart, pos);
 }
@@ -347,8 +362,9 @@ std::optional<Token> Lexer::makeDblConon()
 	Position posStart = pos.Copy();
 	Advance();
 
+	// A single ':' separates keys and values in dictionary literals
 	if (current_char != ':')
-		return std::nullopt;
+		return Token(TT_COLON, std::nullopt, posStart, pos);
 
 	Advance();
 
@@ -0,0 +1,188 @@
+#include "ModuleLoader.hpp"
+#include <algorithm>
+#include <condition_variable>
+#include <fstream>
+#include <sstream>
+#include <thread>
+#include <unordered_set>
+#include "Lexer.hpp"
+#include "Parser.hpp"
+
+std::filesystem::path ModuleLoader::Resolve(const std::string& path, const std::string& importingFile)
+{
+    std::filesystem::path filePath(path);
+
+    // If path is relative, resolve it based on importing file's directory
+    if (!filePath.is_absolute())
+        filePath = std::filesystem::path(importingFile).parent_path().string() + "\\" + path;
+
+    return filePath;
+}
+
+bool ModuleLoader::ReadFile(const std::filesystem::path& path, std::string& content, std::filesystem::file_time_type& modified)
+{
+    // Taken before reading, a change while the file is read shows up as outdated on the next IMPORT
+    std::error_code error;
+    modified = std::filesystem::last_write_time(path, error);
+
+    std::ifstream file(path);
+    if (!file.is_open())
+        return false;
+
+    std::stringstream buffer;
+    buffer << file.rdbuf();
+    content = buffer.str();
+    return true;
+}
+
+std::shared_ptr<ParsedModule> ModuleLoader::Load(const std::filesystem::path& path)
+{
+    auto module = std::make_shared<ParsedModule>();
+
+    std::string fileContent;
+    if (!ReadFile(path, fileContent, module->modified))
+    {
+        module->error = "Could not open import file: " + path.string();
+        return module;
+    }
+    module->hash = std::hash<std::string>{}(fileContent);
+
+    Lexer lexer(path.string(), fileContent);
+    auto lexResult = lexer.MakeTokens();
+    if (lexResult.error != nullptr)
+    {
+        module->error = lexResult.error->AsString();
+        return module;
+    }
+
+    Parser parser(lexResult.tokens);
+    auto parseResult = parser.Parse();
+    if (parseResult.HasError())
+    {
+        module->error = parseResult.GetError();
+        return module;
+    }
+
+    module->tree = parseResult.GetNode();
+    module->imports = parser.GetImports();
+    return module;
+}
+
+void ModuleLoader::Preload(const std::vector<std::string>& imports, const std::string& importingFile)
+{
+    {
+        // Modules of an earlier program whose IMPORT never ran could be outdated by now
+        std::lock_guard<std::mutex> lock(mutex);
+        modules.clear();
+    }
+
+    std::vector<std::filesystem::path> pending;
+    for (const auto& import : imports)
+    {
+        std::error_code error;
+        std::filesystem::path path = std::filesystem::canonical(Resolve(import, importingFile), error);
+        if (!error && Find(path) == nullptr)
+            pending.push_back(path);
+    }
+
+    LoadAll(std::move(pending));
+}
+
+void ModuleLoader::LoadAll(std::vector<std::filesystem::path> pending)
+{
+    if (pending.empty())
+        return;
+
+    // Every file is parsed once, however many modules import it
+    std::unordered_set<std::string> queued;
+    for (const auto& path : pending)
+        queued.insert(path.string());
+
+    std::condition_variable changed;
+    size_t busy = 0;
+
+    auto work = [&]
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        while (true)
+        {
+            // Nothing queued and nothing being parsed that could queue more, every module is loaded
+            changed.wait(lock, [&] { return !pending.empty() || busy == 0; });
+            if (pending.empty())
+                return;
+
+            std::filesystem::path path = std::move(pending.back());
+            pending.pop_back();
+            busy++;
+
+            lock.unlock();
+            std::shared_ptr<ParsedModule> module = Load(path);
+            lock.lock();
+
+            busy--;
+            for (const auto& import : module->imports)
+            {
+                std::error_code error;
+                std::filesystem::path importPath = std::filesystem::canonical(Resolve(import, path.string()), error);
+                if (!error && !modules.contains(importPath.string()) && !built.contains(importPath.string()) && queued.insert(importPath.string()).second)
+                    pending.push_back(std::move(importPath));
+            }
+            modules[path.string()] = std::move(module);
+            changed.notify_all();
+        }
+    };
+
+    // The calling thread is one of the workers
+    std::vector<std::thread> workers;
+    size_t workerCount = std::max(1u, std::thread::hardware_concurrency());
+    for (size_t i = 1; i < workerCount; i++)
+        workers.emplace_back(work);
+    work();
+    for (auto& worker : workers)
+        worker.join();
+}
+
+std::shared_ptr<ParsedModule> ModuleLoader::Take(const std::filesystem::path& path)
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    auto it = modules.find(path.string());
+    if (it == modules.end())
+    {
+        lock.unlock();
+        LoadAll({ path });
+        lock.lock();
+        it = modules.find(path.string());
+    }
+
+    std::shared_ptr<ParsedModule> module = std::move(it->second);
+    modules.erase(it);
+    return module;
+}
+
+std::shared_ptr<SymbolTable> ModuleLoader::Find(const std::filesystem::path& path)
+{
+    auto it = built.find(path.string());
+    if (it == built.end())
+        return nullptr;
+
+    // Only a changed modification time needs the file to be read, the content decides (a touched file is reused)
+    std::error_code error;
+    if (std::filesystem::last_write_time(path, error) != it->second.modified || error)
+    {
+        std::string content;
+        std::filesystem::file_time_type modified;
+        if (!ReadFile(path, content, modified) || std::hash<std::string>{}(content) != it->second.hash)
+        {
+            built.erase(it);
+            return nullptr;
+        }
+        it->second.modified = modified;
+    }
+
+    return it->second.table;
+}
+
+void ModuleLoader::Add(const std::filesystem::path& path, const ParsedModule& module, std::shared_ptr<SymbolTable> table)
+{
+    built[path.string()] = BuiltModule{ std::move(table), module.modified, module.hash };
+}
\ No newline at end of file
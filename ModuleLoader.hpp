@@ -0,0 +1,68 @@
+#pragma once
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+#include "Nodes.hpp"
+
+class SymbolTable;
+
+// Lexed and parsed file of an IMPORT, or the error that stopped it
+struct ParsedModule
+{
+	std::shared_ptr<Node> tree;
+	std::string error;
+	std::vector<std::string> imports;	// Paths of the IMPORTs in the file, relative to it
+	std::filesystem::file_time_type modified;
+	size_t hash = 0;	// Of the file content
+};
+
+// Reads, lexes and parses modules ahead of their IMPORT. Before a program runs, Preload follows the imports
+// of the program and of every module it reaches and parses the files on several threads. The modules are still
+// run one by one, when execution reaches their IMPORT. The first IMPORT of a file builds its module table,
+// later IMPORTs of the same file (from other modules or later programs of the REPL) share it
+class ModuleLoader
+{
+public:
+	// The file an IMPORT of path in importingFile refers to, it may not exist
+	static std::filesystem::path Resolve(const std::string& path, const std::string& importingFile);
+
+	// Parses every module that imports reaches, directly or through other modules, and returns once all are done.
+	// Modules that are built already are skipped. Files that don't exist are left to the IMPORT, it reports them
+	void Preload(const std::vector<std::string>& imports, const std::string& importingFile);
+
+	// The parsed module of a canonical path. A preloaded module is handed out once, an IMPORT of the same file
+	// later reads it again, so it sees changes. Anything that isn't preloaded yet is loaded now, its imports with it
+	std::shared_ptr<ParsedModule> Take(const std::filesystem::path& path);
+
+	// The module table built for a canonical path, nullptr if there is none or the file changed since
+	std::shared_ptr<SymbolTable> Find(const std::filesystem::path& path);
+	void Add(const std::filesystem::path& path, const ParsedModule& module, std::shared_ptr<SymbolTable> table);
+
+	// Marks the module whose IMPORT runs, false if it already runs. The file then imports itself through its imports
+	bool BeginBuild(const std::filesystem::path& path) { return building.insert(path.string()).second; }
+	void EndBuild(const std::filesystem::path& path) { building.erase(path.string()); }
+
+private:
+	struct BuiltModule
+	{
+		std::shared_ptr<SymbolTable> table;
+		std::filesystem::file_time_type modified;
+		size_t hash;
+	};
+
+	std::mutex mutex;
+	std::unordered_map<std::string, std::shared_ptr<ParsedModule>> modules;
+
+	// Only used by the thread that holds the turn, IMPORT isn't allowed in PARALLEL_MAP workers
+	std::unordered_map<std::string, BuiltModule> built;
+	std::unordered_set<std::string> building;
+
+	static bool ReadFile(const std::filesystem::path& path, std::string& content, std::filesystem::file_time_type& modified);
+
+	static std::shared_ptr<ParsedModule> Load(const std::filesystem::path& path);
+	void LoadAll(std::vector<std::filesystem::path> pending);
+};
\ No newline at end of file
@@ -7,6 +7,12 @@ NumberNode::NumberNode(Token token)
 {
 	this->token = token;
 
+	// Converted once here, so evaluating the literal doesn't have to look at the token again
+	if (std::holds_alternative<int64_t>(token.GetValue()))
+		value = std::get<int64_t>(token.GetValue());
+	else if (std::holds_alternative<double>(token.GetValue()))
+		value = std::get<double>(token.GetValue());
+
 	posStart = token.GetPosStart();
 	posEnd = token.GetPosEnd();
 }
@@ -37,6 +43,38 @@ BinOpNode::BinOpNode(std::shared_ptr<Node> leftNode, Token opToken, std::shared_
 	this->leftNode = leftNode;
 	this->opToken = opToken;
 	this->rightNode = rightNode;
+
+	const std::string& type = opToken.GetType();
+	if (type == TT_PLUS)
+		op = Op::Add;
+	else if (type == TT_MINUS)
+		op = Op::Sub;
+	else if (type == TT_MUL)
+		op = Op::Mul;
+	else if (type == TT_DIV)
+		op = Op::Div;
+	else if (type == TT_POW)
+		op = Op::Pow;
+	else if (type == TT_AT)
+		op = Op::At;
+	else if (type == TT_EQEQ)
+		op = Op::Eq;
+	else if (type == TT_NEQ)
+		op = Op::Neq;
+	else if (type == TT_LT)
+		op = Op::Lt;
+	else if (type == TT_GT)
+		op = Op::Gt;
+	else if (type == TT_LTEQ)
+		op = Op::Lte;
+	else if (type == TT_GTEQ)
+		op = Op::Gte;
+	else if (opToken.Matches(TT_KEYWORD, "AND"))
+		op = Op::And;
+	else if (opToken.Matches(TT_KEYWORD, "OR"))
+		op = Op::Or;
+	else
+		op = Op::Unknown;
 }
 
 std::string BinOpNode::Repr()
@@ -156,6 +194,22 @@ std::string ForNode::Repr()
 	return std::string();
 }
 
+ForInNode::ForInNode(Token varNameTok, std::shared_ptr<Node> iterableNode, std::shared_ptr<Node> bodyNode, bool shouldReturnNull)
+{
+	this->varNameTok = varNameTok;
+	this->iterableNode = iterableNode;
+	this->bodyNode = bodyNode;
+	this->shouldReturnNull = shouldReturnNull;
+
+	posStart = varNameTok.GetPosStart();
+	posEnd = varNameTok.GetPosEnd();
+}
+
+std::string ForInNode::Repr()
+{
+	return std::string();
+}
+
 WhileNode::WhileNode(std::shared_ptr<Node> conditionNode, std::shared_ptr<Node> bodyNode, bool shouldReturnNull)
 {
 	this->conditionNode = conditionNode;
@@ -190,6 +244,8 @@ FuncDefNode::FuncDefNode(std::optional<Token> varNameTok, std::vector<Token> arg
 
 std::string FuncDefNode::Repr()
 {
+	if (!varNameTok.has_value())
+		return "<function '<anonymous>'>";
 	return "<function '" + std::get<std::string>(varNameTok.value().GetValue()) + "'>";
 }
 
@@ -236,6 +292,28 @@ std::string ListNode::Repr()
 	return result;
 }
 
+DictNode::DictNode(std::vector<std::pair<std::shared_ptr<Node>, std::shared_ptr<Node>>> entryNodes, Position posStart, Position posEnd)
+{
+	this->entryNodes = entryNodes;
+	this->posStart = posStart;
+	this->posEnd = posEnd;
+}
+
+std::string DictNode::Repr()
+{
+	std::string result = "{";
+	for (size_t i = 0; i < entryNodes.size(); ++i)
+	{
+		result += entryNodes[i].first->Repr() + ": " + entryNodes[i].second->Repr();
+		if (i != entryNodes.size() - 1)
+		{
+			result += ", ";
+		}
+	}
+	result += "}";
+	return result;
+}
+
 ReturnNode::ReturnNode(std::optional<std::shared_ptr<Node>> nodeToReturn, Position posStart, Position posEnd)
 {
 	this->nodeToReturn = nodeToReturn;
@@ -248,6 +326,42 @@ std::string ReturnNode::Repr()
 	return std::string();
 }
 
+YieldNode::YieldNode(std::shared_ptr<Node> nodeToYield, Position posStart, Position posEnd)
+{
+	this->nodeToYield = nodeToYield;
+	this->posStart = posStart;
+	this->posEnd = posEnd;
+}
+
+std::string YieldNode::Repr()
+{
+	return std::string();
+}
+
+SpawnNode::SpawnNode(std::shared_ptr<CallNode> callNode, Position posStart, Position posEnd)
+{
+	this->callNode = callNode;
+	this->posStart = posStart;
+	this->posEnd = posEnd;
+}
+
+std::string SpawnNode::Repr()
+{
+	return "(SPAWN " + callNode->Repr() + ")";
+}
+
+AwaitNode::AwaitNode(std::shared_ptr<Node> taskNode, Position posStart, Position posEnd)
+{
+	this->taskNode = taskNode;
+	this->posStart = posStart;
+	this->posEnd = posEnd;
+}
+
+std::string AwaitNode::Repr()
+{
+	return "(AWAIT " + taskNode->Repr() + ")";
+}
+
 ContinueNode::ContinueNode(Position posStart, Position posEnd)
 {
 	this->posStart = posStart;
@@ -270,10 +384,11 @@ std::string BreakNode::Repr()
 	return std::string();
 }
 
-ImportNode::ImportNode(Token filepathToken, std::string alias, Position posStart, Position posEnd)
+ImportNode::ImportNode(Token filepathToken, std::string alias, bool lazy, Position posStart, Position posEnd)
 {
 	this->filepathToken = filepathToken;
 	this->alias = alias;
+	this->lazy = lazy;
 	this->posStart = posStart;
 	this->posEnd = posEnd;
 }
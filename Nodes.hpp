@@ -1,6 +1,21 @@
 #pragma once
 #include "Token.hpp"
 #include <vector>
+#include <cstdint>
+
+class SymbolTable;
+
+// Inline cache of a global variable lookup, filled and checked by the Interpreter
+struct VariableCache
+{
+	uint64_t tableId = 0;				// Table the lookup started in, 0 while the cache is empty
+	uint64_t chainVersion = 0;			// Shape version of that table and its parents when the cache was filled
+	SymbolTable* owner = nullptr;		// Table the variable was found in
+	size_t index = 0;
+
+	uint64_t modulesGeneration = 0;		// Only for namespaced accesses: imports the module table was cached for
+	SymbolTable* moduleTable = nullptr;
+};
 
 class Node
 {
@@ -21,8 +36,8 @@ public:
 	IfCase() = default;
 	IfCase(std::shared_ptr<Node> condition, std::shared_ptr<Node> expr, bool shouldReturnNull) : condition(condition), expr(expr), shouldReturnNull(shouldReturnNull) {}
 
-	std::shared_ptr<Node> GetCondition() { return condition; }
-	std::shared_ptr<Node> GetExpr() { return expr; }
+	const std::shared_ptr<Node>& GetCondition() const { return condition; }
+	const std::shared_ptr<Node>& GetExpr() const { return expr; }
 	bool GetShouldReturnNull() const { return shouldReturnNull; }
 
 private:
@@ -38,10 +53,12 @@ public:
 	NumberNode(Token token);
 
 	std::string Repr() override;
-	Token GetToken() { return token; };
+	const Token& GetToken() const { return token; };
+	const std::variant<int64_t, double>& GetValue() const { return value; }
 
 private:
 	Token token;
+	std::variant<int64_t, double> value = int64_t(0);
 };
 
 class StringNode : public Node
@@ -51,7 +68,7 @@ public:
 	StringNode(Token token);
 
 	std::string Repr() override;
-	Token GetToken() { return token; };
+	const Token& GetToken() const { return token; };
 
 private:
 	Token token;
@@ -64,28 +81,47 @@ public:
 	ListNode(std::vector<std::shared_ptr<Node>> elementNodes, Position posStart, Position posEnd);
 
 	std::string Repr() override;
-	std::vector<std::shared_ptr<Node>> GetElementNodes() { return elementNodes; }
+	const std::vector<std::shared_ptr<Node>>& GetElementNodes() const { return elementNodes; }
 
 private:
 	std::vector<std::shared_ptr<Node>> elementNodes;
 };
 
+class DictNode : public Node
+{
+public:
+	DictNode(std::vector<std::pair<std::shared_ptr<Node>, std::shared_ptr<Node>>> entryNodes, Position posStart, Position posEnd);
+
+	std::string Repr() override;
+	const std::vector<std::pair<std::shared_ptr<Node>, std::shared_ptr<Node>>>& GetEntryNodes() const { return entryNodes; }
+
+private:
+	std::vector<std::pair<std::shared_ptr<Node>, std::shared_ptr<Node>>> entryNodes;
+};
+
 class VarAccessNode : public Node
 {
 public:
 	VarAccessNode(Token varNameTok, std::optional<std::string> moduleAlias);
 
 	std::string Repr() override;
-	Token GetVarNameToken() { return varNameTok; }
+	const Token& GetVarNameToken() const { return varNameTok; }
 	Position GetPosStart() { return posStart; }
 	Position GetPosEnd() { return posEnd; }
-	std::optional<std::string> GetModuleAlias() { return moduleAlias; }
+	const std::optional<std::string>& GetModuleAlias() const { return moduleAlias; }
 
 	bool IsNamespaced() const { return moduleAlias.has_value(); }
 
+	// Frame slot of the variable if it is a local of the enclosing function, -1 for globals (see Resolver)
+	int GetSlot() const { return slot; }
+	void SetSlot(int slot) { this->slot = slot; }
+	VariableCache& GetCache() { return cache; }
+
 private:
 	Token varNameTok;
 	std::optional<std::string> moduleAlias;
+	int slot = -1;
+	VariableCache cache;
 };
 
 class VarAssignNode : public Node
@@ -94,28 +130,43 @@ public:
 	VarAssignNode(Token varNameTok, std::shared_ptr<Node> node);
 
 	std::string Repr() override;
-	Token GetVarNameToken() { return varNameTok; }
-	std::shared_ptr<Node> GetValueNode() { return node; }
+	const Token& GetVarNameToken() const { return varNameTok; }
+	const std::shared_ptr<Node>& GetValueNode() const { return node; }
+	int GetSlot() const { return slot; }
+	void SetSlot(int slot) { this->slot = slot; }
+	VariableCache& GetCache() { return cache; }
 
 private:
 	Token varNameTok;
 	std::shared_ptr<Node> node;
+	int slot = -1;
+	VariableCache cache;
 };
 
 class BinOpNode : public Node
 {
 public:
+	// Operator resolved once from the token, so evaluation doesn't compare token type strings
+	enum class Op : uint8_t { Add, Sub, Mul, Div, Pow, At, Eq, Neq, Lt, Gt, Lte, Gte, And, Or, Unknown };
+	// Operand types this node was specialised for by the Interpreter, Generic once it saw mixed types
+	enum class Quickening : uint8_t { None, IntInt, NumNum, StrStr, Generic };
+
 	BinOpNode(std::shared_ptr<Node> leftNode, Token opToken, std::shared_ptr<Node> rightNode);
 
 	std::string Repr() override;
-	std::shared_ptr<Node> GetLeftNode() { return leftNode; };
-	Token GetOpToken() { return opToken; };
-	std::shared_ptr<Node> GetRightNode() { return rightNode; };
+	const std::shared_ptr<Node>& GetLeftNode() const { return leftNode; };
+	const Token& GetOpToken() const { return opToken; };
+	const std::shared_ptr<Node>& GetRightNode() const { return rightNode; };
+	Op GetOp() const { return op; }
+	Quickening GetQuickening() const { return quickening; }
+	void SetQuickening(Quickening quickening) { this->quickening = quickening; }
 
 private:
 	std::shared_ptr<Node> leftNode;
 	Token opToken;
 	std::shared_ptr<Node> rightNode;
+	Op op;
+	Quickening quickening = Quickening::None;
 };
 
 class UnaryOpNode : public Node
@@ -124,8 +175,8 @@ public:
 	UnaryOpNode(Token opToken, std::shared_ptr<Node> node);
 
 	std::string Repr() override;
-	Token GetOpToken() { return opToken; }
-	std::shared_ptr<Node> GetNode() { return node; }
+	const Token& GetOpToken() const { return opToken; }
+	const std::shared_ptr<Node>& GetNode() const { return node; }
 
 private:
 	Token opToken;
@@ -138,8 +189,8 @@ public:
 	IfNode(std::vector<IfCase> cases, std::shared_ptr<Node> elseCase);
 
 	std::string Repr() override;
-	std::vector<IfCase> GetCases() { return cases; }
-	std::shared_ptr<Node> GetElseCase() { return elseCase; }
+	const std::vector<IfCase>& GetCases() const { return cases; }
+	const std::shared_ptr<Node>& GetElseCase() const { return elseCase; }
 
 private:
 	std::vector<IfCase> cases;
@@ -152,15 +203,20 @@ public:
 	ForNode(Token varNameTok, std::shared_ptr<Node> startValueNode, std::shared_ptr<Node> endValueNode, std::shared_ptr<Node> stepValueNode=nullptr, std::shared_ptr<Node> bodyNode=nullptr, bool shouldReturnNull=false);
 
 	std::string Repr() override;
-	Token GetVarNameTok() { return varNameTok; }
-	std::shared_ptr<Node> GetStartValueNode() { return startValueNode; }
-	std::shared_ptr<Node> GetEndValueNode() { return endValueNode; }
-	std::shared_ptr<Node> GetStepValueNode() { return stepValueNode; }
-	std::shared_ptr<Node> GetBodyNode() { return bodyNode; }
+	const Token& GetVarNameTok() const { return varNameTok; }
+	const std::shared_ptr<Node>& GetStartValueNode() const { return startValueNode; }
+	const std::shared_ptr<Node>& GetEndValueNode() const { return endValueNode; }
+	const std::shared_ptr<Node>& GetStepValueNode() const { return stepValueNode; }
+	const std::shared_ptr<Node>& GetBodyNode() const { return bodyNode; }
 	bool GetShouldReturnNull() const { return shouldReturnNull; }
+	int GetSlot() const { return slot; }
+	void SetSlot(int slot) { this->slot = slot; }
+	VariableCache& GetCache() { return cache; }
 
 private:
 	Token varNameTok;
+	int slot = -1;
+	VariableCache cache;
 	std::shared_ptr<Node> startValueNode;
 	std::shared_ptr<Node> endValueNode;
 	std::shared_ptr<Node> stepValueNode;
@@ -168,14 +224,38 @@ private:
 	bool shouldReturnNull;
 };
 
+// FOR x IN iterable, runs the body once for every element of a list, dictionary (its keys), string or iterator
+class ForInNode : public Node
+{
+public:
+	ForInNode(Token varNameTok, std::shared_ptr<Node> iterableNode, std::shared_ptr<Node> bodyNode, bool shouldReturnNull);
+
+	std::string Repr() override;
+	const Token& GetVarNameTok() const { return varNameTok; }
+	const std::shared_ptr<Node>& GetIterableNode() const { return iterableNode; }
+	const std::shared_ptr<Node>& GetBodyNode() const { return bodyNode; }
+	bool GetShouldReturnNull() const { return shouldReturnNull; }
+	int GetSlot() const { return slot; }
+	void SetSlot(int slot) { this->slot = slot; }
+	VariableCache& GetCache() { return cache; }
+
+private:
+	Token varNameTok;
+	int slot = -1;
+	VariableCache cache;
+	std::shared_ptr<Node> iterableNode;
+	std::shared_ptr<Node> bodyNode;
+	bool shouldReturnNull;
+};
+
 class WhileNode : public Node
 {
 public:
 	WhileNode(std::shared_ptr<Node> conditionNode, std::shared_ptr<Node> bodyNode, bool shouldReturnNull);
 
 	std::string Repr() override;
-	std::shared_ptr<Node> GetConditionNode() { return conditionNode; }
-	std::shared_ptr<Node> GetBodyNode() { return bodyNode; }
+	const std::shared_ptr<Node>& GetConditionNode() const { return conditionNode; }
+	const std::shared_ptr<Node>& GetBodyNode() const { return bodyNode; }
 	bool GetShouldReturnNull() const { return shouldReturnNull; }
 
 private:
@@ -190,16 +270,31 @@ public:
 	FuncDefNode(std::optional<Token> varNameTok, std::vector<Token> argNameToks, std::shared_ptr<Node> bodyNode, bool shouldAutoReturn);
 
 	std::string Repr() override;
-	std::optional<Token> GetVarNameTok() { return varNameTok; }
-	std::vector<Token> GetArgNameToks() { return argNameToks; }
-	std::shared_ptr<Node> GetBodyNode() { return bodyNode; }
+	const std::optional<Token>& GetVarNameTok() const { return varNameTok; }
+	const std::vector<Token>& GetArgNameToks() const { return argNameToks; }
+	const std::shared_ptr<Node>& GetBodyNode() const { return bodyNode; }
 	bool GetShouldAutoReturn() const { return shouldAutoReturn; }
 
+	// Slot of the function name in the enclosing function's frame, -1 if it is defined globally
+	int GetSlot() const { return slot; }
+	void SetSlot(int slot) { this->slot = slot; }
+	// Number of parameter and local variable slots a call of this function needs
+	size_t GetFrameSize() const { return frameSize; }
+	void SetFrameSize(size_t frameSize) { this->frameSize = frameSize; }
+	VariableCache& GetCache() { return cache; }
+	// Set by the Resolver if the body contains YIELD, calling the function then creates a generator
+	bool IsGenerator() const { return isGenerator; }
+	void SetGenerator(bool isGenerator) { this->isGenerator = isGenerator; }
+
 private:
 	std::optional<Token> varNameTok;
 	std::vector<Token> argNameToks;
 	std::shared_ptr<Node> bodyNode;
 	bool shouldAutoReturn;
+	int slot = -1;
+	size_t frameSize = 0;
+	VariableCache cache;
+	bool isGenerator = false;
 };
 
 class CallNode : public Node
@@ -208,12 +303,35 @@ public:
 	CallNode(std::shared_ptr<Node> nodeToCall, std::vector<std::shared_ptr<Node>> argNodes);
 
 	std::string Repr() override;
-	std::shared_ptr<Node> GetNodeToCall() { return nodeToCall; }
-	std::vector<std::shared_ptr<Node>> GetArgNodes() { return argNodes; }
+	const std::shared_ptr<Node>& GetNodeToCall() const { return nodeToCall; }
+	const std::vector<std::shared_ptr<Node>>& GetArgNodes() const { return argNodes; }
+
+	// Set by the Resolver for calls whose result is directly returned by the enclosing function
+	bool IsTailCall() const { return isTailCall; }
+	void SetTailCall(bool isTailCall) { this->isTailCall = isTailCall; }
+
+	// Callee body inlined into this call site and the inlined copy (see Inliner). Only the first callee is tried,
+	// a callee that couldn't be inlined isn't kept, its body may contain this node (recursion)
+	bool GetInlineTried() const { return inlineTried; }
+	const std::shared_ptr<Node>& GetInlinedFrom() const { return inlinedFrom; }
+	const std::shared_ptr<Node>& GetInlined() const { return inlined; }
+	void SetInlined(std::shared_ptr<Node> inlinedFrom, std::shared_ptr<Node> inlined)
+	{
+		inlineTried = true;
+		if (inlined != nullptr)
+		{
+			this->inlinedFrom = std::move(inlinedFrom);
+			this->inlined = std::move(inlined);
+		}
+	}
 
 private:
 	std::shared_ptr<Node> nodeToCall;
 	std::vector<std::shared_ptr<Node>> argNodes;
+	bool isTailCall = false;
+	bool inlineTried = false;
+	std::shared_ptr<Node> inlinedFrom;
+	std::shared_ptr<Node> inlined;
 };
 
 class ReturnNode : public Node
@@ -222,12 +340,54 @@ public:
 	ReturnNode(std::optional<std::shared_ptr<Node>> nodeToReturn, Position posStart, Position posEnd);
 
 	std::string Repr() override;
-	std::optional<std::shared_ptr<Node>> GetNodeToReturn() { return nodeToReturn; }
+	const std::optional<std::shared_ptr<Node>>& GetNodeToReturn() const { return nodeToReturn; }
 
 private:
 	std::optional<std::shared_ptr<Node>> nodeToReturn;
 };
 
+class YieldNode : public Node
+{
+public:
+	YieldNode(std::shared_ptr<Node> nodeToYield, Position posStart, Position posEnd);
+
+	std::string Repr() override;
+	const std::shared_ptr<Node>& GetNodeToYield() const { return nodeToYield; }
+	// Set by the Resolver if the YIELD is reached only through blocks, IF cases and loop bodies, which can save
+	// where they were and continue there. A YIELD inside an expression can't be resumed
+	bool IsResumable() const { return isResumable; }
+	void SetResumable(bool isResumable) { this->isResumable = isResumable; }
+
+private:
+	std::shared_ptr<Node> nodeToYield;
+	bool isResumable = false;
+};
+
+// SPAWN f(args), the call runs as a task
+class SpawnNode : public Node
+{
+public:
+	SpawnNode(std::shared_ptr<CallNode> callNode, Position posStart, Position posEnd);
+
+	std::string Repr() override;
+	const std::shared_ptr<CallNode>& GetCallNode() const { return callNode; }
+
+private:
+	std::shared_ptr<CallNode> callNode;
+};
+
+class AwaitNode : public Node
+{
+public:
+	AwaitNode(std::shared_ptr<Node> taskNode, Position posStart, Position posEnd);
+
+	std::string Repr() override;
+	const std::shared_ptr<Node>& GetTaskNode() const { return taskNode; }
+
+private:
+	std::shared_ptr<Node> taskNode;
+};
+
 class ContinueNode : public Node
 {
 public:
@@ -247,13 +407,16 @@ public:
 class ImportNode : public Node
 {
 public:
-	ImportNode(Token filepathToken, std::string alias, Position posStart, Position posEnd);
+	ImportNode(Token filepathToken, std::string alias, bool lazy, Position posStart, Position posEnd);
 
 	std::string Repr() override;
-	Token GetFilepathToken() { return filepathToken; }
-	std::string GetAlias() { return alias; }
+	const Token& GetFilepathToken() const { return filepathToken; }
+	const std::string& GetAlias() const { return alias; }
+	// LAZY IMPORT, the module only runs once one of its names is used
+	bool IsLazy() const { return lazy; }
 
 private:
 	Token filepathToken;
 	std::string alias;
+	bool lazy;
 };
\ No newline at end of file
@@ -0,0 +1,187 @@
+#include "Parallel.hpp"
+#include "Task.hpp"
+#include <algorithm>
+#include <atomic>
+#include <barrier>
+#include <mutex>
+#include <thread>
+
+namespace
+{
+    // Indices a worker still has to run, the owner takes them from the front and thieves from the back
+    struct WorkRange
+    {
+        std::mutex mutex;
+        size_t next = 0;
+        size_t end = 0;
+    };
+
+    bool TakeIndex(WorkRange& range, size_t& index)
+    {
+        std::lock_guard<std::mutex> lock(range.mutex);
+        if (range.next >= range.end)
+            return false;
+
+        index = range.next++;
+        return true;
+    }
+
+    // Moves the back half of victim into the (empty) range of the thief
+    bool StealHalf(WorkRange& victim, WorkRange& thief)
+    {
+        size_t start, end;
+        {
+            std::lock_guard<std::mutex> lock(victim.mutex);
+            if (victim.next >= victim.end)
+                return false;
+
+            end = victim.end;
+            start = end - (end - victim.next + 1) / 2;
+            victim.end = start;
+        }
+
+        std::lock_guard<std::mutex> lock(thief.mutex);
+        thief.next = start;
+        thief.end = end;
+        return true;
+    }
+}
+
+RTResult ParallelFor(Interpreter& interpreter, size_t count, size_t workerCount, const std::function<RTResult(Interpreter&, size_t)>& body)
+{
+    if (count == 0)
+        return RTResult().Success(std::nullopt);
+
+    // Every call owns what it allocates, however many workers run. The lists and dictionaries from before the
+    // call can be shared with the other calls, changing them fails even without workers
+    Heap& heap = interpreter.GetHeap();
+    auto call = [&](Interpreter& worker, size_t index)
+    {
+        uint32_t previous = Heap::SetThreadOwner(heap.NewOwner());
+        RTResult result = body(worker, index);
+        Heap::SetThreadOwner(previous);
+        return result;
+    };
+
+    RTResult first = call(interpreter, 0);
+    if (first.HasError())
+        return first;
+
+    // Workers of a PARALLEL_MAP that is already running don't start another pool, the heap is already shared
+    workerCount = std::min(workerCount, count - 1);
+    if (workerCount <= 1 || interpreter.IsWorker())
+    {
+        for (size_t i = 1; i < count; i++)
+        {
+            RTResult result = call(interpreter, i);
+            if (result.HasError())
+                return result;
+        }
+        return RTResult().Success(std::nullopt);
+    }
+
+    Scheduler& scheduler = interpreter.GetScheduler();
+
+    // Created here, so their frames register as root providers before any other thread runs
+    std::vector<std::unique_ptr<Interpreter>> workers;
+    for (size_t i = 0; i < workerCount; i++)
+        workers.push_back(std::make_unique<Interpreter>(interpreter, nullptr, true));
+
+    std::vector<WorkRange> ranges(workerCount);
+    std::vector<RootStack> roots(workerCount);
+    std::vector<AllocationBuffer> buffers(workerCount);
+    std::atomic<bool> failed = false;
+    std::mutex errorMutex;
+    RTResult error;
+
+    auto runWorker = [&](size_t self)
+    {
+        size_t index;
+        while (!failed.load(std::memory_order_relaxed))
+        {
+            if (!TakeIndex(ranges[self], index))
+            {
+                bool stolen = false;
+                for (size_t i = 1; i < workerCount && !stolen; i++)
+                    stolen = StealHalf(ranges[(self + i) % workerCount], ranges[self]);
+                if (!stolen)
+                    return;
+                continue;
+            }
+
+            RTResult result = call(*workers[self], index);
+            if (result.HasError())
+            {
+                std::lock_guard<std::mutex> lock(errorMutex);
+                if (!failed)
+                {
+                    error = std::move(result);
+                    failed = true;
+                }
+                return;
+            }
+        }
+    };
+
+    // The indices run in batches. Nothing is collected while the workers run, between two batches every
+    // worker waits at the barrier and the calling thread collects, which bounds the garbage a batch can leave
+    const size_t batchSize = 256 * workerCount;
+    bool done = false;
+    std::barrier sync(static_cast<std::ptrdiff_t>(workerCount));
+
+    std::vector<std::thread> threads;
+    for (size_t self = 1; self < workerCount; self++)
+    {
+        threads.emplace_back([&, self]
+        {
+            Heap::SetThreadRoots(&roots[self]);
+            Heap::SetThreadBuffer(&buffers[self]);
+            while (true)
+            {
+                sync.arrive_and_wait();
+                if (done)
+                    return;
+                runWorker(self);
+                scheduler.WorkerFinished();
+                sync.arrive_and_wait();
+            }
+        });
+    }
+
+    // The calling thread is worker 0 and keeps pushing onto its own root stack
+    Heap::SetThreadBuffer(&buffers[0]);
+    for (size_t start = 1; start < count && !failed; start += batchSize)
+    {
+        size_t end = std::min(count, start + batchSize);
+        size_t share = (end - start + workerCount - 1) / workerCount;
+        for (size_t i = 0; i < workerCount; i++)
+        {
+            ranges[i].next = std::min(end, start + i * share);
+            ranges[i].end = std::min(end, ranges[i].next + share);
+        }
+
+        heap.SetConcurrent(true);
+        scheduler.BeginExclusive(workerCount);
+        sync.arrive_and_wait();
+        runWorker(0);
+        scheduler.WorkerFinished();
+        sync.arrive_and_wait();
+        scheduler.EndExclusive();
+        heap.SetConcurrent(false);
+
+        // What the batch allocated only joins the heap here, the workers never contend for its lock
+        for (auto& buffer : buffers)
+            heap.Adopt(buffer);
+        heap.CollectIfNeeded();
+    }
+    Heap::SetThreadBuffer(nullptr);
+
+    done = true;
+    sync.arrive_and_wait();
+    for (auto& thread : threads)
+        thread.join();
+
+    if (failed)
+        return error;
+    return RTResult().Success(std::nullopt);
+}
\ No newline at end of file
@@ -0,0 +1,10 @@
+#pragma once
+#include <functional>
+#include "Interpreter.hpp"
+
+// Runs body(worker, i) for every i in [0, count) on up to workerCount threads. Index 0 runs on interpreter first,
+// so the caches on the nodes are filled before the workers, which only read them, start. Every worker has an
+// interpreter (frames), a root stack and an allocation buffer of its own and takes indices from its own range, a
+// worker that runs out steals the back half of another range. Each call is a new heap owner (Heap::NewOwner).
+// Stops at the first error and returns it
+RTResult ParallelFor(Interpreter& interpreter, size_t count, size_t workerCount, const std::function<RTResult(Interpreter&, size_t)>& body);
\ No newline at end of file
@@ -1,4 +1,5 @@
 #include "Parser.hpp"
+#include "Resolver.hpp"
 #include <algorithm>
 
 Parser::Parser(std::vector<Token> tokens)
@@ -107,6 +108,17 @@ ParseResult Parser::Statement()
 		return res.Success(std::make_unique<ReturnNode>(expr, posStart, currentToken.GetPosEnd().Copy()));
 	}
 
+	if (currentToken.Matches(TT_KEYWORD, "YIELD"))
+	{
+		Advance();
+		res.RegisterAdvancement();
+
+		std::shared_ptr<Node> expr = res.Register(Expr());
+		if (res.HasError())
+			return res;
+		return res.Success(std::make_shared<YieldNode>(expr, posStart, currentToken.GetPosEnd().Copy()));
+	}
+
 	if (currentToken.Matches(TT_KEYWORD, "CONTINUE"))
 	{
 		Advance();
@@ -134,7 +146,7 @@ ParseResult Parser::Statement()
 
 	std::shared_ptr<Node> expr = res.Register(Expr());
 	if (res.HasError())
-		return res.Failure(std::make_unique<InvalidSyntaxError>(currentToken.GetPosStart(), currentToken.GetPosEnd(), "Expected int, float, identifier, VAR, '+', '-', '(', '[', 'IF', 'FOR', 'WHILE', 'FUNC', 'RETURN', 'CONTINUE', 'BREAK' or NOT"));
+		return res.Failure(std::make_unique<InvalidSyntaxError>(currentToken.GetPosStart(), currentToken.GetPosEnd(), "Expected int, float, identifier, VAR, '+', '-', '(', '[', 'IF', 'FOR', 'WHILE', 'FUNC', 'RETURN', 'YIELD', 'SPAWN', 'AWAIT', 'CONTINUE', 'BREAK' or NOT"));
 
 	return res.Success(expr);
 }
@@ -147,6 +159,14 @@ ParseResult Parser::ImportStatement()
 	Advance();
 	res.RegisterAdvancement();
 
+	bool lazy = false;
+	if (currentToken.Matches(TT_KEYWORD, "LAZY"))
+	{
+		lazy = true;
+		Advance();
+		res.RegisterAdvancement();
+	}
+
 	if (!currentToken.Matches(TT_KEYWORD, "IMPORT"))
 		return res.Failure(std::make_unique<InvalidSyntaxError>(currentToken.GetPosStart(), currentToken.GetPosEnd(), "Expected 'IMPORT'"));
 
@@ -175,7 +195,11 @@ ParseResult Parser::ImportStatement()
 	Advance();
 	res.RegisterAdvancement();
 
-	return res.Success(std::make_unique<ImportNode>(filepathToken, alias, posStart, currentToken.GetPosEnd().Copy()));
+	// Lazy modules aren't parsed ahead, the program may never use them
+	if (!lazy)
+		imports.push_back(std::get<std::string>(filepathToken.GetValue()));
+
+	return res.Success(std::make_unique<ImportNode>(filepathToken, alias, lazy, posStart, currentToken.GetPosEnd().Copy()));
 }
 
 ParseResult Parser::Expr()
@@ -283,6 +307,30 @@ ParseResult Parser::Factor()
 		return res.Success(std::make_shared<UnaryOpNode>(tok, factor));
 	}
 
+	if (tok.Matches(TT_KEYWORD, "SPAWN"))
+	{
+		Advance();
+		res.RegisterAdvancement();
+		std::shared_ptr<Node> call = res.Register(Call());
+		if (res.HasError())
+			return res;
+
+		auto callNode = std::dynamic_pointer_cast<CallNode>(call);
+		if (callNode == nullptr)
+			return res.Failure(std::make_unique<InvalidSyntaxError>(tok.GetPosStart(), currentToken.GetPosEnd(), "Expected a function call after 'SPAWN'"));
+		return res.Success(std::make_shared<SpawnNode>(callNode, tok.GetPosStart(), currentToken.GetPosEnd().Copy()));
+	}
+
+	if (tok.Matches(TT_KEYWORD, "AWAIT"))
+	{
+		Advance();
+		res.RegisterAdvancement();
+		std::shared_ptr<Node> factor = res.Register(Factor());
+		if (res.HasError())
+			return res;
+		return res.Success(std::make_shared<AwaitNode>(factor, tok.GetPosStart(), currentToken.GetPosEnd().Copy()));
+	}
+
 	return Power();
 }
 
@@ -409,6 +457,14 @@ ParseResult Parser::Atom()
 
 		return res.Success(listExpr);
 	}
+	else if (tok.GetType() == TT_LCURLYBRACKET)
+	{
+		std::shared_ptr<Node> dictExpr = res.Register(DictExpr());
+		if (res.HasError())
+			return res;
+
+		return res.Success(dictExpr);
+	}
 	else if (tok.Matches(TT_KEYWORD, "IF"))
 	{
 		std::shared_ptr<Node> ifExpr = res.Register(IfExpr());
@@ -438,7 +494,7 @@ ParseResult Parser::Atom()
 		return res.Success(funcDef);
 	}
 
-	return res.Failure(std::make_unique<InvalidSyntaxError>(tok.GetPosStart(), tok.GetPosEnd(), "Expected int, float, identifier, '+', '-', '(', '[', 'IF', 'FOR', 'WHILE', 'FUNC'"));
+	return res.Failure(std::make_unique<InvalidSyntaxError>(tok.GetPosStart(), tok.GetPosEnd(), "Expected int, float, identifier, '+', '-', '(', '[', '{', 'IF', 'FOR', 'WHILE', 'FUNC'"));
 }
 
 ParseResult Parser::ListExpr()
@@ -484,6 +540,60 @@ ParseResult Parser::ListExpr()
 	return res.Success(std::make_unique<ListNode>(elementNodes, posStart, currentToken.GetPosEnd().Copy()));
 }
 
+ParseResult Parser::DictExpr()
+{
+	ParseResult res;
+	std::vector<std::pair<std::shared_ptr<Node>, std::shared_ptr<Node>>> entryNodes;
+	Position posStart = currentToken.GetPosStart().Copy();
+
+	if (currentToken.GetType() != TT_LCURLYBRACKET)
+		return res.Failure(std::make_unique<InvalidSyntaxError>(currentToken.GetPosStart(), currentToken.GetPosEnd(), "Expected '{'"));
+
+	Advance();
+	res.RegisterAdvancement();
+
+	if (currentToken.GetType() == TT_RCURLYBRACKET)
+	{
+		Advance();
+		res.RegisterAdvancement();
+	}
+	else
+	{
+		while (true)
+		{
+			std::shared_ptr<Node> keyNode = res.Register(Expr());
+			if (res.HasError())
+				return res;
+
+			if (currentToken.GetType() != TT_COLON)
+				return res.Failure(std::make_unique<InvalidSyntaxError>(currentToken.GetPosStart(), currentToken.GetPosEnd(), "Expected ':'"));
+
+			Advance();
+			res.RegisterAdvancement();
+
+			std::shared_ptr<Node> valueNode = res.Register(Expr());
+			if (res.HasError())
+				return res;
+
+			entryNodes.emplace_back(keyNode, valueNode);
+
+			if (currentToken.GetType() != TT_COMMA)
+				break;
+
+			Advance();
+			res.RegisterAdvancement();
+		}
+
+		if (currentToken.GetType() != TT_RCURLYBRACKET)
+			return res.Failure(std::make_unique<InvalidSyntaxError>(currentToken.GetPosStart(), currentToken.GetPosEnd(), "Expected ',' or '}'"));
+
+		Advance();
+		res.RegisterAdvancement();
+	}
+
+	return res.Success(std::make_unique<DictNode>(entryNodes, posStart, currentToken.GetPosEnd().Copy()));
+}
+
 ParseResult Parser::IfExpr()
 {
 	ParseResult res;
@@ -657,37 +767,51 @@ ParseResult Parser::ForExpr()
 	Advance();
 	res.RegisterAdvancement();
 
-	if (currentToken.GetType() != TT_EQ)
-		return res.Failure(std::make_unique<InvalidSyntaxError>(currentToken.GetPosStart(), currentToken.GetPosEnd(), "Expected '='"));
-
-	Advance();
-	res.RegisterAdvancement();
+	// FOR x IN iterable walks the elements, FOR x = start TO end counts
+	std::shared_ptr<Node> iterable;
+	std::shared_ptr<Node> startValue;
+	std::shared_ptr<Node> endValue;
+	std::shared_ptr<Node> stepValue;
+	if (currentToken.Matches(TT_KEYWORD, "IN"))
+	{
+		Advance();
+		res.RegisterAdvancement();
 
-	std::shared_ptr<Node> startValue = res.Register(Expr());
-	if (res.HasError())
-		return res;
+		iterable = res.Register(Expr());
+		if (res.HasError())
+			return res;
+	}
+	else
+	{
+		if (currentToken.GetType() != TT_EQ)
+			return res.Failure(std::make_unique<InvalidSyntaxError>(currentToken.GetPosStart(), currentToken.GetPosEnd(), "Expected '=' or 'IN'"));
 
-	if (!currentToken.Matches(TT_KEYWORD, "TO"))
-		return res.Failure(std::make_unique<InvalidSyntaxError>(currentToken.GetPosStart(), currentToken.GetPosEnd(), "Expected 'TO'"));
+		Advance();
+		res.RegisterAdvancement();
 
-	Advance();
-	res.RegisterAdvancement();
+		startValue = res.Register(Expr());
+		if (res.HasError())
+			return res;
 
-	std::shared_ptr<Node> endValue = res.Register(Expr());
-	if (res.HasError())
-		return res;
+		if (!currentToken.Matches(TT_KEYWORD, "TO"))
+			return res.Failure(std::make_unique<InvalidSyntaxError>(currentToken.GetPosStart(), currentToken.GetPosEnd(), "Expected 'TO'"));
 
-	std::shared_ptr<Node> stepValue;
-	if (currentToken.Matches(TT_KEYWORD, "STEP"))
-	{
 		Advance();
 		res.RegisterAdvancement();
-		stepValue = res.Register(Expr());
+
+		endValue = res.Register(Expr());
 		if (res.HasError())
 			return res;
+
+		if (currentToken.Matches(TT_KEYWORD, "STEP"))
+		{
+			Advance();
+			res.RegisterAdvancement();
+			stepValue = res.Register(Expr());
+			if (res.HasError())
+				return res;
+		}
 	}
-	else
-		stepValue = nullptr;
 
 	if (!currentToken.Matches(TT_KEYWORD, "THEN"))
 		return res.Failure(std::make_unique<InvalidSyntaxError>(currentToken.GetPosStart(), currentToken.GetPosEnd(), "Expected 'THEN'"));
@@ -695,6 +819,13 @@ ParseResult Parser::ForExpr()
 	Advance();
 	res.RegisterAdvancement();
 
+	auto makeNode = [&](std::shared_ptr<Node> body, bool shouldReturnNull) -> std::shared_ptr<Node>
+	{
+		if (iterable != nullptr)
+			return std::make_shared<ForInNode>(varName, iterable, body, shouldReturnNull);
+		return std::make_shared<ForNode>(varName, startValue, endValue, stepValue, body, shouldReturnNull);
+	};
+
 	if (currentToken.GetType() == TT_NEWLINE)
 	{
 		Advance();
@@ -710,14 +841,14 @@ ParseResult Parser::ForExpr()
 		Advance();
 		res.RegisterAdvancement();
 
-		return res.Success(std::make_unique<ForNode>(varName, startValue, endValue, stepValue, body, true));
+		return res.Success(makeNode(body, true));
 	}
 
 	std::shared_ptr<Node> body = res.Register(Statement());
 	if (res.HasError())
 		return res;
 
-	return res.Success(std::make_shared<ForNode>(varName, startValue, endValue, stepValue, body, false));
+	return res.Success(makeNode(body, false));
 }
 
 ParseResult Parser::WhileExpr()
@@ -843,7 +974,9 @@ ParseResult Parser::FuncDef()
 		if (res.HasError())
 			return res;
 
-		return res.Success(std::make_shared<FuncDefNode>(varNameTok, argNameToks, nodeToReturn, true));
+		auto funcDef = std::make_shared<FuncDefNode>(varNameTok, argNameToks, nodeToReturn, true);
+		Resolver::ResolveFunction(*funcDef);
+		return res.Success(funcDef);
 	}
 	
 	if (currentToken.GetType() != TT_NEWLINE)
@@ -862,7 +995,9 @@ ParseResult Parser::FuncDef()
 	Advance();
 	res.RegisterAdvancement();
 
-	return res.Success(std::make_shared<FuncDefNode>(varNameTok, argNameToks, body, false));
+	auto funcDef = std::make_shared<FuncDefNode>(varNameTok, argNameToks, body, false);
+	Resolver::ResolveFunction(*funcDef);
+	return res.Success(funcDef);
 }
 
 ParseResult Parser::BinOp(std::function<ParseResult()> func_a, std::vector<std::string> ops, std::function<ParseResult()> func_b)
@@ -74,6 +74,8 @@ public:
 	void UpdateCurrentToken();
 
 	ParseResult Parse();
+	// Paths of every IMPORT parsed so far (except LAZY ones), in the order they appear
+	const std::vector<std::string>& GetImports() const { return imports; }
 
 	ParseResult Statements();
 	ParseResult Statement();
@@ -87,6 +89,7 @@ public:
 	ParseResult Call();
 	ParseResult Atom();
 	ParseResult ListExpr();
+	ParseResult DictExpr();
 	ParseResult IfExpr();
 	ParseResult IfExprB();
 	ParseResult IfExprC(std::shared_ptr<IfCase>& outElseCase);
@@ -103,4 +106,5 @@ private:
 	std::vector<Token> tokens;
 	int tokIdx = -1;
 	Token currentToken;
+	std::vector<std::string> imports;
 };
\ No newline at end of file
@@ -12,8 +12,8 @@ Position::Position(int idx, int ln, int col, const std::string& fn, const std::s
 	this->idx = idx;
 	this->ln = ln;
 	this->col = col;
-	this->fn = fn;
-	this->ftxt = ftxt;
+	this->fn = std::make_shared<const std::string>(fn);
+	this->ftxt = std::make_shared<const std::string>(ftxt);
 }
 
 Position Position::Advance(char current_char)
@@ -30,7 +30,13 @@ Position Position::Advance(char current_char)
 	return *this;
 }
 
-Position Position::Copy()
+Position Position::Copy() const
 {
-	return Position(idx, ln, col, fn, ftxt);
+	return *this;
+}
+
+const std::string& Position::Empty()
+{
+	static const std::string empty;
+	return empty;
 }
@@ -1,5 +1,6 @@
 #pragma once
 #include <iostream>
+#include <memory>
 
 class Position
 {
@@ -8,19 +9,22 @@ public:
 	Position(int idx, int ln, int col, const std::string& fn, const std::string& ftxt);
 
 	Position Advance(char current_char=NULL);
-	Position Copy();
+	Position Copy() const;
 
-	int GetIdx() { return idx; }
-	std::string GetFileName() { return fn; }
-	int GetLineNumber() { return ln; }
-	std::string GetFileContent() { return ftxt; }
-	int GetColumn() { return col; }
+	int GetIdx() const { return idx; }
+	const std::string& GetFileName() const { return fn != nullptr ? *fn : Empty(); }
+	int GetLineNumber() const { return ln; }
+	const std::string& GetFileContent() const { return ftxt != nullptr ? *ftxt : Empty(); }
+	int GetColumn() const { return col; }
 
 private:
 	int idx;
 	int ln;
 	int col;
-	std::string fn;
-	std::string ftxt;
+	// Shared by every position in the file, tokens and nodes copy positions a lot
+	std::shared_ptr<const std::string> fn;
+	std::shared_ptr<const std::string> ftxt;
+
+	static const std::string& Empty();
 
 };
\ No newline at end of file
@@ -0,0 +1,163 @@
+#include "Resolver.hpp"
+
+void Resolver::ResolveFunction(FuncDefNode& funcDef)
+{
+    Resolver resolver;
+
+    // Parameters take the first slots, so a call can fill them in order (with duplicate names the last one wins)
+    const auto& argNameToks = funcDef.GetArgNameToks();
+    for (size_t i = 0; i < argNameToks.size(); ++i)
+        resolver.slots[std::get<std::string>(argNameToks[i].GetValue())] = static_cast<int>(i);
+    resolver.slotCount = static_cast<int>(argNameToks.size());
+
+    resolver.Resolve(funcDef.GetBodyNode(), true);
+
+    // The body of an arrow function is returned
+    if (funcDef.GetShouldAutoReturn())
+        resolver.returnedNodes.push_back(funcDef.GetBodyNode());
+    if (!resolver.hasYield)
+    {
+        for (const auto& returnedNode : resolver.returnedNodes)
+            MarkTailCalls(returnedNode);
+    }
+
+    // Accesses are resolved last, a variable assigned after its first use is still local
+    for (VarAccessNode* access : resolver.accesses)
+    {
+        auto it = resolver.slots.find(std::get<std::string>(access->GetVarNameToken().GetValue()));
+        if (it != resolver.slots.end())
+            access->SetSlot(it->second);
+    }
+
+    funcDef.SetFrameSize(resolver.slotCount);
+    funcDef.SetGenerator(resolver.hasYield);
+}
+
+int Resolver::Declare(const std::string& name)
+{
+    auto it = slots.find(name);
+    if (it != slots.end())
+        return it->second;
+
+    int slot = slotCount++;
+    slots.emplace(name, slot);
+    return slot;
+}
+
+void Resolver::MarkTailCalls(const std::shared_ptr<Node>& node)
+{
+    if (auto call = dynamic_cast<CallNode*>(node.get()))
+        call->SetTailCall(true);
+    else if (auto ifNode = dynamic_cast<IfNode*>(node.get()))
+    {
+        // Block bodies drop their value, only single expression cases pass it on
+        for (const IfCase& ifCase : ifNode->GetCases())
+        {
+            if (!ifCase.GetShouldReturnNull())
+                MarkTailCalls(ifCase.GetExpr());
+        }
+
+        // The ELSE case is an IfNode of its own
+        MarkTailCalls(ifNode->GetElseCase());
+    }
+}
+
+void Resolver::Resolve(const std::shared_ptr<Node>& node, bool resumable)
+{
+    if (node == nullptr)
+        return;
+
+    if (auto list = dynamic_cast<ListNode*>(node.get()))
+    {
+        for (const auto& elementNode : list->GetElementNodes())
+            Resolve(elementNode, resumable);
+    }
+    else if (auto dict = dynamic_cast<DictNode*>(node.get()))
+    {
+        for (const auto& [keyNode, valueNode] : dict->GetEntryNodes())
+        {
+            Resolve(keyNode);
+            Resolve(valueNode);
+        }
+    }
+    else if (auto binOp = dynamic_cast<BinOpNode*>(node.get()))
+    {
+        Resolve(binOp->GetLeftNode());
+        Resolve(binOp->GetRightNode());
+    }
+    else if (auto unary = dynamic_cast<UnaryOpNode*>(node.get()))
+        Resolve(unary->GetNode());
+    else if (auto varAccess = dynamic_cast<VarAccessNode*>(node.get()))
+    {
+        if (!varAccess->IsNamespaced())
+            accesses.push_back(varAccess);
+    }
+    else if (auto varAssign = dynamic_cast<VarAssignNode*>(node.get()))
+    {
+        Resolve(varAssign->GetValueNode());
+        varAssign->SetSlot(Declare(std::get<std::string>(varAssign->GetVarNameToken().GetValue())));
+    }
+    else if (auto ifNode = dynamic_cast<IfNode*>(node.get()))
+    {
+        for (const IfCase& ifCase : ifNode->GetCases())
+        {
+            Resolve(ifCase.GetCondition());
+            Resolve(ifCase.GetExpr(), resumable);
+        }
+        Resolve(ifNode->GetElseCase(), resumable);
+    }
+    else if (auto forNode = dynamic_cast<ForNode*>(node.get()))
+    {
+        forNode->SetSlot(Declare(std::get<std::string>(forNode->GetVarNameTok().GetValue())));
+        Resolve(forNode->GetStartValueNode());
+        Resolve(forNode->GetEndValueNode());
+        Resolve(forNode->GetStepValueNode());
+        Resolve(forNode->GetBodyNode(), resumable);
+    }
+    else if (auto forIn = dynamic_cast<ForInNode*>(node.get()))
+    {
+        forIn->SetSlot(Declare(std::get<std::string>(forIn->GetVarNameTok().GetValue())));
+        Resolve(forIn->GetIterableNode());
+        Resolve(forIn->GetBodyNode(), resumable);
+    }
+    else if (auto whileNode = dynamic_cast<WhileNode*>(node.get()))
+    {
+        Resolve(whileNode->GetConditionNode());
+        Resolve(whileNode->GetBodyNode(), resumable);
+    }
+    else if (auto funcDef = dynamic_cast<FuncDefNode*>(node.get()))
+    {
+        // Nested functions were already resolved when they were parsed, only their name belongs to this frame
+        if (funcDef->GetVarNameTok().has_value())
+            funcDef->SetSlot(Declare(std::get<std::string>(funcDef->GetVarNameTok().value().GetValue())));
+    }
+    else if (auto call = dynamic_cast<CallNode*>(node.get()))
+    {
+        Resolve(call->GetNodeToCall());
+        for (const auto& argNode : call->GetArgNodes())
+            Resolve(argNode);
+    }
+    else if (auto return_ = dynamic_cast<ReturnNode*>(node.get()))
+    {
+        if (return_->GetNodeToReturn().has_value())
+        {
+            const auto& nodeToReturn = return_->GetNodeToReturn().value();
+            Resolve(nodeToReturn);
+            returnedNodes.push_back(nodeToReturn);
+        }
+    }
+    else if (auto yield = dynamic_cast<YieldNode*>(node.get()))
+    {
+        hasYield = true;
+        yield->SetResumable(resumable);
+        Resolve(yield->GetNodeToYield());
+    }
+    else if (auto spawn = dynamic_cast<SpawnNode*>(node.get()))
+    {
+        Resolve(spawn->GetCallNode());
+    }
+    else if (auto await = dynamic_cast<AwaitNode*>(node.get()))
+    {
+        Resolve(await->GetTaskNode());
+    }
+}
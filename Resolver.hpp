@@ -0,0 +1,31 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <memory>
+#include <unordered_map>
+#include "Nodes.hpp"
+
+// Gives every parameter and local variable of a function a fixed slot in its call frame, so the interpreter
+// reaches them by index instead of through a symbol table. A name is local if it is a parameter or assigned
+// anywhere in the function body (VAR, FOR, named FUNC), every other name is looked up in the globals.
+// Calls in tail position (RETURN f(...), the body of an arrow function and the cases of a returned IF, ELSE included) are marked as tail calls.
+// A function with a YIELD in its own body (not in a nested FUNC) is marked as generator. A generator gets no tail calls, its body
+// keeps its frame between the YIELDs, and YIELDs that are only nested in blocks, IF cases and loop bodies are marked resumable.
+class Resolver
+{
+public:
+	static void ResolveFunction(FuncDefNode& funcDef);
+
+private:
+	std::unordered_map<std::string, int> slots;
+	std::vector<VarAccessNode*> accesses;
+	int slotCount = 0;
+	bool hasYield = false;
+	std::vector<std::shared_ptr<Node>> returnedNodes;	// Marked for tail calls once the function turned out not to be a generator
+
+	int Declare(const std::string& name);
+	// resumable is set while node is only nested in blocks, IF cases and loop bodies of the function body
+	void Resolve(const std::shared_ptr<Node>& node, bool resumable = false);
+	// Marks the calls whose value becomes the value of node
+	static void MarkTailCalls(const std::shared_ptr<Node>& node);
+};
\ No newline at end of file
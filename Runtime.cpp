@@ -0,0 +1,185 @@
+#include "Runtime.hpp"
+#include "Lexer.hpp"
+#include "Parser.hpp"
+#include "Helper.hpp"
+
+Runtime::Runtime(std::ostream& output, std::istream& input) : globals(heap), output(output), input(input)
+{
+    globals.Set("NULL", static_cast<int64_t>(0));
+    globals.Set("TRUE", static_cast<int64_t>(1));
+    globals.Set("FALSE", static_cast<int64_t>(0));
+    globals.Set("MATH_PI", static_cast<double>(3.141592653589793));
+    globals.Set("PRINT", heap.Allocate<NativePrintFunction>(*this));
+    globals.Set("PRINTLN", heap.Allocate<NativePrintLnFunction>(*this));
+    globals.Set("LENGTH", heap.Allocate<NativeLengthFunction>());
+    globals.Set("INPUT_STR", heap.Allocate<NativeInputStr>(*this));
+    globals.Set("INPUT_NUM", heap.Allocate<NativeInputNum>(*this));
+    globals.Set("IS_NUM", heap.Allocate<NativeIsNum>());
+    globals.Set("IS_STR", heap.Allocate<NativeIsStr>());
+    globals.Set("IS_LIST", heap.Allocate<NativeIsList>());
+    globals.Set("IS_DICT", heap.Allocate<NativeIsDict>());
+    globals.Set("IS_FUNC", heap.Allocate<NativeIsFunc>());
+    globals.Set("APPEND", heap.Allocate<NativeAppend>());
+    globals.Set("POP", heap.Allocate<NativePop>());
+    globals.Set("EXTEND", heap.Allocate<NativeExtend>());
+    globals.Set("CLEAR", heap.Allocate<NativeClear>(*this));
+    globals.Set("SYSTEM", heap.Allocate<NativeSystem>(*this));
+    globals.Set("RANDOM", heap.Allocate<NativeRandom>(*this));
+    globals.Set("RANDOMIZE", heap.Allocate<NativeRandomize>(*this));
+    globals.Set("INSERT", heap.Allocate<NativeInsert>());
+    globals.Set("DELETE", heap.Allocate<NativeDelete>());
+    globals.Set("HAS_KEY", heap.Allocate<NativeHasKey>());
+    globals.Set("KEYS", heap.Allocate<NativeKeys>(heap));
+    globals.Set("VALUES", heap.Allocate<NativeValues>(heap));
+    globals.Set("RANGE", heap.Allocate<NativeRange>(heap));
+    globals.Set("MEMOIZE", heap.Allocate<NativeMemoize>(heap));
+    globals.Set("MEMO_STATS", heap.Allocate<NativeMemoStats>(heap));
+    globals.Set("CHANNEL", heap.Allocate<NativeChannel>(*this));
+    globals.Set("SEND", heap.Allocate<NativeSend>());
+    globals.Set("RECV", heap.Allocate<NativeRecv>());
+    globals.Set("CLOSE", heap.Allocate<NativeClose>());
+    globals.Set("READ_FILE", heap.Allocate<NativeReadFile>(*this));
+    globals.Set("WRITE_FILE", heap.Allocate<NativeWriteFile>(*this));
+    globals.Set("RUN", heap.Allocate<NativeRun>(*this));
+    globals.Set("TIMER", heap.Allocate<NativeTimer>(*this));
+    globals.Set("PARALLEL_MAP", heap.Allocate<NativeParallelMap>());
+    globals.Set("PARALLEL_FOR", heap.Allocate<NativeParallelFor>());
+}
+
+Runtime::~Runtime()
+{
+    Flush();
+}
+
+bool Runtime::Run(const std::string& fileName, const std::string& text, const std::string& mainFilePath, bool isFile, bool printTokens, bool printAst)
+{
+    // Generate tokens
+    Lexer lexer(fileName, text);
+    MakeTokensResult tokenResult = lexer.MakeTokens();
+
+    if (tokenResult.error != nullptr)
+    {
+        Write(tokenResult.error->AsString() + "\n");
+        Flush();
+        return false;
+    }
+
+    // Print tokenResult
+    if (printTokens)
+        Write("Token result: " + Helper::TokenVectorToString(tokenResult.tokens) + "\n");
+
+    // Generate AST
+    Parser parser(tokenResult.tokens);
+    ParseResult ast = parser.Parse();
+
+    if (ast.HasError())
+    {
+        Write(ast.GetError() + "\n");
+        Flush();
+        return false;
+    }
+
+    // Print ast
+    if (printAst)
+        Write("AST: " + ast.GetNode()->Repr() + "\n");
+
+    // The modules the program imports are parsed up front, in parallel
+    modules.Preload(parser.GetImports(), mainFilePath);
+
+    Interpreter interpreter(globals, scheduler, modules);
+    interpreter.SetMainFilePath(mainFilePath);
+    auto result = interpreter.Visit(ast.GetNode());
+
+    // Tasks that were never awaited still run to their end, the tasks can collect meanwhile
+    std::vector<SymbolValue> resultValue;
+    if (result.GetValue().has_value())
+        resultValue.push_back(result.GetValue().value());
+    GCRoot resultRoot(heap, resultValue);
+    scheduler.WaitForTasks();
+
+    if (result.HasError())
+    {
+        Write(result.GetError() + "\n");
+        Flush();
+        return false;
+    }
+
+    // Print result
+    if (result.GetValue().has_value())
+    {
+        if (!isFile)
+            Print({ &result.GetValue().value(), 1 }, true);
+        else // Because when reading from file everything is inputted as on giant block, so every result in it is in another list
+        {
+            if (std::holds_alternative<List*>(result.GetValue().value()))
+            {
+                auto listPtr = std::get<List*>(result.GetValue().value());
+                for (const auto& element : listPtr->elements)
+                {
+                    Print({ &element, 1 }, true);
+                }
+            }
+            else
+            {
+                Print({ &result.GetValue().value(), 1 }, true);
+            }
+        }
+    }
+
+    Flush();
+    return true;
+}
+
+int64_t Runtime::Random(int64_t min, int64_t max)
+{
+    if (min > max)
+        std::swap(min, max);
+
+    std::lock_guard<std::mutex> lock(randomMutex);
+    return std::uniform_int_distribution<int64_t>(min, max)(random);
+}
+
+void Runtime::Seed(uint64_t seed)
+{
+    std::lock_guard<std::mutex> lock(randomMutex);
+    random.seed(seed);
+}
+
+void Runtime::Print(std::span<const SymbolValue> values, bool newline)
+{
+    std::lock_guard<std::mutex> lock(outputMutex);
+    size_t start = outputBuffer.size();
+    for (const auto& value : values)
+        Helper::Print(outputBuffer, value);
+    if (newline)
+        outputBuffer += '\n';
+    Written(start);
+}
+
+void Runtime::Write(std::string_view text)
+{
+    std::lock_guard<std::mutex> lock(outputMutex);
+    size_t start = outputBuffer.size();
+    outputBuffer += text;
+    Written(start);
+}
+
+void Runtime::Flush()
+{
+    std::lock_guard<std::mutex> lock(outputMutex);
+    WriteBuffer();
+}
+
+void Runtime::Written(size_t start)
+{
+    if (outputBuffer.size() >= outputBufferSize || (lineBuffered && outputBuffer.find('\n', start) != std::string::npos))
+        WriteBuffer();
+}
+
+void Runtime::WriteBuffer()
+{
+    if (!outputBuffer.empty())
+        output.write(outputBuffer.data(), static_cast<std::streamsize>(outputBuffer.size()));
+    output.flush();
+    outputBuffer.clear();
+}
\ No newline at end of file
@@ -0,0 +1,63 @@
+#pragma once
+#include <iostream>
+#include <random>
+#include <mutex>
+#include <span>
+#include <string_view>
+#include "Interpreter.hpp"
+#include "Task.hpp"
+#include "ModuleLoader.hpp"
+
+// Everything a running script owns: its heap, its globals with the builtins, random numbers and the console
+// streams. Runtimes share no state, so several scripts can run on separate threads of one process at once
+class Runtime
+{
+public:
+	Runtime(std::ostream& output = std::cout, std::istream& input = std::cin);
+	Runtime(const Runtime&) = delete;
+	Runtime& operator=(const Runtime&) = delete;
+	~Runtime();
+
+	// Lexes, parses and runs text, fileName is shown in errors and mainFilePath is what imports are relative to.
+	// Returns once the tasks the program spawned finished too. Errors and the value of the program go to the
+	// output, a file prints the value of every top-level statement on a line of its own. Returns false if there
+	// was an error
+	bool Run(const std::string& fileName, const std::string& text, const std::string& mainFilePath, bool isFile, bool printTokens = false, bool printAst = false);
+
+	Heap& GetHeap() { return heap; }
+	Scheduler& GetScheduler() { return scheduler; }
+	SymbolTable& GetGlobals() { return globals; }
+	std::istream& Input() { return input; }
+
+	// Output is collected in a buffer that goes to the output stream when it is full, at the end of Run and
+	// before anything else uses the console (INPUT_*, SYSTEM, CLEAR). Line buffered (the REPL), it also goes out
+	// with every newline. PARALLEL_MAP workers print at the same time, every call is written as a whole
+	void Print(std::span<const SymbolValue> values, bool newline);
+	void Write(std::string_view text);
+	void Flush();
+	void SetLineBuffered(bool lineBuffered) { this->lineBuffered = lineBuffered; }
+
+	// Number from min to max (both inclusive). Locked, PARALLEL_MAP workers draw from the same generator
+	int64_t Random(int64_t min, int64_t max);
+	void Seed(uint64_t seed);
+
+private:
+	Scheduler scheduler;
+	Heap heap;
+	SymbolTable globals;
+	ModuleLoader modules;	// After globals, the module tables it keeps are destroyed before the heap and the globals
+	std::ostream& output;
+	std::istream& input;
+
+	std::mt19937_64 random;
+	std::mutex randomMutex;
+
+	static constexpr size_t outputBufferSize = 64 * 1024;
+	std::string outputBuffer;
+	std::mutex outputMutex;
+	bool lineBuffered = false;
+
+	// Called with outputMutex held after appending from start on
+	void Written(size_t start);
+	void WriteBuffer();
+};
\ No newline at end of file
@@ -0,0 +1,341 @@
+#include "Task.hpp"
+#include <algorithm>
+#include <thread>
+
+void Scheduler::Start(Task* task)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    running++;
+    runnable.push_back(task);
+}
+
+void Scheduler::StartExternal()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    running++;
+    external++;
+}
+
+void Scheduler::Finished(WaitList& waiters)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    running--;
+    while (!waiters.waiters.empty())
+        Wake(waiters.waiters.front());
+    while (running == 0 && !idle.waiters.empty())
+        Wake(idle.waiters.front());
+}
+
+void Scheduler::Post(std::function<void()> completion)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    external--;
+    completions.push_back(std::move(completion));
+    posted.notify_one();
+}
+
+void Scheduler::Wake(Waiter* waiter)
+{
+    std::deque<Waiter*>& waiters = waiter->list->waiters;
+    if (waiters.front() == waiter)
+        waiters.pop_front();
+    else
+        waiters.erase(std::find(waiters.begin(), waiters.end(), waiter));
+
+    parked[waiter->parkedIndex] = parked.back();
+    parked[waiter->parkedIndex]->parkedIndex = waiter->parkedIndex;
+    parked.pop_back();
+
+    waiter->woken = true;
+    if (waiter->task != nullptr)
+        runnable.push_back(waiter->task);
+}
+
+void Scheduler::WakeOne(WaitList& list)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    if (!list.waiters.empty())
+        Wake(list.waiters.front());
+    Progressed();
+}
+
+void Scheduler::WakeAll(WaitList& list)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    while (!list.waiters.empty())
+        Wake(list.waiters.front());
+    Progressed();
+}
+
+void Scheduler::Progressed()
+{
+    if (!exclusive)
+        return;
+
+    // Every stalled worker retries, none of them counts as stalled until it failed again
+    progress.store(progress.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    if (stalledWorkers > 0)
+    {
+        stalledWorkers = 0;
+        stalledWake.notify_all();
+    }
+}
+
+void Scheduler::BeginExclusive(size_t workers)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    exclusive = true;
+    activeWorkers = workers;
+    stalledWorkers = 0;
+    workersDeadlocked = false;
+}
+
+void Scheduler::EndExclusive()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    exclusive = false;
+}
+
+void Scheduler::CheckWorkersDeadlock()
+{
+    if (stalledWorkers > 0 && stalledWorkers == activeWorkers)
+    {
+        workersDeadlocked = true;
+        stalledWake.notify_all();
+    }
+}
+
+void Scheduler::WorkerFinished()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    activeWorkers--;
+    CheckWorkersDeadlock();
+}
+
+bool Scheduler::Stall(uint64_t seen)
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    if (progress.load(std::memory_order_relaxed) != seen)
+        return true;
+
+    stalledWorkers++;
+    CheckWorkersDeadlock();
+    stalledWake.wait(lock, [&] { return workersDeadlocked || progress.load(std::memory_order_relaxed) != seen; });
+    return !workersDeadlocked;
+}
+
+bool Scheduler::Park(WaitList& list)
+{
+    Waiter waiter;
+    waiter.task = current;
+    waiter.list = &list;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        list.waiters.push_back(&waiter);
+        waiter.parkedIndex = parked.size();
+        parked.push_back(&waiter);
+    }
+
+    // A task goes back to the program's thread, which resumes it once it is runnable again
+    if (current != nullptr)
+        current->fiber->Suspend();
+    else
+        RunUntil(waiter);
+    return !waiter.deadlock;
+}
+
+void Scheduler::RunUntil(Waiter& waiter)
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    while (!waiter.woken)
+    {
+        if (!completions.empty())
+        {
+            std::vector<std::function<void()>> ready = std::move(completions);
+            completions.clear();
+            lock.unlock();
+            for (auto& completion : ready)
+                completion();
+            lock.lock();
+        }
+        else if (!runnable.empty())
+        {
+            Task* task = runnable.front();
+            runnable.pop_front();
+            lock.unlock();
+            Resume(task);
+            lock.lock();
+        }
+        else if (external > 0)
+            posted.wait(lock);
+        else
+        {
+            // Nothing can run and nothing outside the script will report back, the waiters all wait for each other
+            while (!parked.empty())
+            {
+                parked.back()->deadlock = true;
+                Wake(parked.back());
+            }
+        }
+    }
+}
+
+void Scheduler::Resume(Task* task)
+{
+    if (task->fiber == nullptr)
+    {
+        if (idleFibers.empty())
+            task->fiber = std::make_unique<Fiber>(FiberMain, this);
+        else
+        {
+            task->fiber = std::move(idleFibers.back());
+            idleFibers.pop_back();
+        }
+    }
+
+    current = task;
+    Heap::SetThreadRoots(&task->roots);
+    uint32_t owner = Heap::SetThreadOwner(task->heapOwner);
+    task->fiber->Resume();
+    task->heapOwner = Heap::SetThreadOwner(owner);
+    Heap::SetThreadRoots(nullptr);
+    current = nullptr;
+
+    if (task->finished)
+    {
+        if (idleFibers.size() < maxIdleFibers)
+            idleFibers.push_back(std::move(task->fiber));
+        task->fiber.reset();
+    }
+}
+
+void Scheduler::FiberMain(void* scheduler)
+{
+    // Runs one task after the other, a fiber is only resumed again once it was handed to the next one
+    Scheduler& self = *static_cast<Scheduler*>(scheduler);
+    while (true)
+    {
+        Task* task = self.current;
+        task->Run();
+        task->fiber->Suspend();
+    }
+}
+
+void Scheduler::Block(const std::function<void()>& operation)
+{
+    // Nothing else could run meanwhile, or nothing may (PARALLEL_MAP workers)
+    bool others;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        others = !exclusive && running != 0;
+        if (others)
+            external++;
+    }
+    if (!others)
+    {
+        operation();
+        return;
+    }
+
+    WaitList done;
+    bool finished = false;
+    std::thread thread([&]
+    {
+        operation();
+        Post([&]
+        {
+            finished = true;
+            WakeAll(done);
+        });
+    });
+
+    // Can't deadlock, the operation counts as external until its completion ran
+    while (!finished)
+        Park(done);
+    thread.join();
+}
+
+void Scheduler::WaitForTasks()
+{
+    while (true)
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (running == 0)
+                return;
+        }
+        Park(idle);
+    }
+}
+
+Task::Task(Interpreter& creator, SymbolValue callee, std::vector<SymbolValue> args)
+    : Awaitable(creator.GetScheduler()), heap(creator.GetHeap()), interpreter(std::make_unique<Interpreter>(creator, nullptr)),
+      callee(std::move(callee)), args(std::move(args))
+{
+    heap.AddRootProvider(this);
+    scheduler.Start(this);
+}
+
+void Task::Run()
+{
+    RTResult result;
+    if (std::holds_alternative<Function*>(callee) && !std::get<Function*>(callee)->prototype->IsGenerator())
+        result = interpreter->CallWithArgs(std::get<Function*>(callee), args);
+    else
+        result = interpreter->CallValue(callee, args);
+
+    if (result.HasError())
+        error = result.GetError();
+    else
+        value = result.GetValue();
+
+    interpreter.reset();
+    args.clear();
+    heap.RemoveRootProvider(this);
+
+    finished = true;
+    scheduler.Finished(awaiters);
+}
+
+bool Awaitable::Await(std::optional<SymbolValue>& value, std::string& error)
+{
+    if (!finished && scheduler.IsExclusive())
+    {
+        error = "AWAIT of an unfinished task or request can't be used inside PARALLEL_MAP or PARALLEL_FOR";
+        return false;
+    }
+
+    while (!finished)
+    {
+        if (!scheduler.Park(awaiters))
+        {
+            error = "Deadlock, every task is waiting";
+            return false;
+        }
+    }
+
+    value = this->value;
+    error = this->error;
+    return error.empty();
+}
+
+void Awaitable::Trace(Heap& heap)
+{
+    if (value.has_value())
+        heap.Mark(value.value());
+}
+
+void Task::Trace(Heap& heap)
+{
+    Awaitable::Trace(heap);
+    heap.Mark(callee);
+    for (const auto& arg : args)
+        heap.Mark(arg);
+}
+
+void Task::TraceRoots(Heap& heap)
+{
+    // Everything the running call holds is on its frames (a root of their own) and its root stack
+    heap.Mark(this);
+    roots.Trace(heap);
+}
\ No newline at end of file
@@ -0,0 +1,166 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include "Fiber.hpp"
+#include "Interpreter.hpp"
+
+class Task;
+class WaitList;
+
+// A task or the program parked in a WaitList, it lives on the stack of whoever waits
+struct Waiter
+{
+	Task* task = nullptr;	// Null for the program itself
+	WaitList* list = nullptr;
+	size_t parkedIndex = 0;
+	bool woken = false;
+	bool deadlock = false;
+};
+
+// The waiters of one thing that can become ready, a task, a request or one side of a channel. Waking it only
+// makes its own waiters runnable
+class WaitList
+{
+private:
+	friend class Scheduler;
+	std::deque<Waiter*> waiters;
+};
+
+// Runs the tasks of one runtime. They all run on the thread that runs the program, each on a fiber of its own
+// while it runs or waits, so they are cooperative: they switch at AWAIT, at a SEND or RECV that has to wait, at
+// the end of a task and while a builtin blocks (SYSTEM, INPUT_*). A task that waits is parked in the WaitList of
+// what it waits for and only runs again once that changed. Tasks get a fiber on their first run and give it back
+// for the next one when they finish
+class Scheduler
+{
+public:
+	Scheduler() = default;
+	Scheduler(const Scheduler&) = delete;
+	Scheduler& operator=(const Scheduler&) = delete;
+
+	// Exclusive while workers of PARALLEL_MAP run. Nothing is switched then, a task would run next to the workers
+	void BeginExclusive(size_t workers);
+	void EndExclusive();
+	bool IsExclusive() const { return exclusive; }
+	// Called by a worker that ran out of indices, it can't change a channel anymore
+	void WorkerFinished();
+	// Called by a worker that can't SEND or RECV. Sleeps until a channel operation of another worker succeeded
+	// after progress was seen (Progress). Returns false if every worker that still runs is stalled, the other
+	// tasks can't run meanwhile, so nothing could ever change the channels they wait for
+	bool Stall(uint64_t seen);
+	uint64_t Progress() const { return progress.load(std::memory_order_acquire); }
+
+	// Queues task to run, it counts as running until it calls Finished
+	void Start(Task* task);
+	// Counts an operation that runs on a thread of its own (an I/O request) as running until Finished, the
+	// program waits for it and a script waiting only on such operations isn't a deadlock
+	void StartExternal();
+	// Called on the program's thread when a task or an operation ended, wakes everything in waiters
+	void Finished(WaitList& waiters);
+	// The thread of an external operation reports back through completion, it runs on the program's thread the
+	// next time the scheduler gets to run
+	void Post(std::function<void()> completion);
+
+	// Waits until list is woken, running the other tasks meanwhile. Returns false instead if nothing could ever
+	// wake it, every task and the program wait then, so all of them get false and unwind
+	bool Park(WaitList& list);
+	// Make the first or every waiter of list runnable and let stalled workers retry. Locked, PARALLEL_MAP workers
+	// call them as well
+	void WakeOne(WaitList& list);
+	void WakeAll(WaitList& list);
+
+	// Runs operation on a thread of its own while the other tasks run, for builtins that wait for something
+	// outside the script
+	void Block(const std::function<void()>& operation);
+
+	// Called by the program, runs the tasks until all of them finished
+	void WaitForTasks();
+
+private:
+	// Fibers of finished tasks that are kept for the next ones, the rest is freed
+	static constexpr size_t maxIdleFibers = 16;
+
+	std::mutex mutex;	// Guards everything below but the fibers, which only the program's thread touches
+	std::condition_variable posted;	// Signalled by Post while the program waits for an external operation
+	std::deque<Task*> runnable;
+	std::vector<std::function<void()>> completions;
+	std::vector<Waiter*> parked;
+	size_t running = 0;
+	size_t external = 0;	// Operations on threads of their own that will still post a completion
+	WaitList idle;	// Woken when running drops to 0
+	bool exclusive = false;
+
+	std::condition_variable stalledWake;
+	std::atomic<uint64_t> progress = 0;	// Successful channel operations of workers
+	size_t activeWorkers = 0;
+	size_t stalledWorkers = 0;
+	bool workersDeadlocked = false;
+
+	Task* current = nullptr;	// Task whose fiber runs, null while the program runs
+	std::vector<std::unique_ptr<Fiber>> idleFibers;
+
+	// Runs completions and tasks on the program's thread until waiter was woken
+	void RunUntil(Waiter& waiter);
+	void Resume(Task* task);
+	// Called with mutex held
+	void Wake(Waiter* waiter);
+	void Progressed();
+	void CheckWorkersDeadlock();
+
+	static void FiberMain(void* scheduler);
+};
+
+// Something AWAIT waits for, a task or an I/O request. Its outcome is stored and finished is set on the
+// program's thread
+class Awaitable : public Handle
+{
+public:
+	Awaitable(Scheduler& scheduler) : scheduler(scheduler) {}
+
+	// Lets other tasks run until this one finished, then hands out its value. Returns false with the error
+	// message if it failed, every AWAIT of the same one gets the same
+	bool Await(std::optional<SymbolValue>& value, std::string& error);
+
+	void Trace(Heap& heap) override;
+
+protected:
+	Scheduler& scheduler;
+	std::optional<SymbolValue> value;
+	std::string error;
+	std::atomic<bool> finished = false;
+	WaitList awaiters;
+};
+
+// Call started by SPAWN. It runs on a fiber, because the interpreter keeps its state on the C++ stack, and
+// pushes onto a root stack of its own. A task that hasn't finished is a root, it can't be collected while its
+// fiber still uses it
+class Task : public Awaitable, public RootProvider
+{
+public:
+	Task(Interpreter& creator, SymbolValue callee, std::vector<SymbolValue> args);
+	Task(const Task&) = delete;
+	Task& operator=(const Task&) = delete;
+
+	std::string ToString() const override { return "<task>"; }
+	void Trace(Heap& heap) override;
+	void TraceRoots(Heap& heap) override;
+	size_t Size() const override { return sizeof(Task) + args.capacity() * sizeof(SymbolValue); }
+
+private:
+	friend class Scheduler;
+
+	Heap& heap;
+	std::unique_ptr<Interpreter> interpreter;
+	SymbolValue callee;
+	std::vector<SymbolValue> args;
+	RootStack roots;
+	uint32_t heapOwner = 0;	// Heap owner of the thread while the task is suspended, see Heap::NewOwner
+	std::unique_ptr<Fiber> fiber;	// From its first run until it finished
+
+	void Run();
+};
\ No newline at end of file
@@ -3,7 +3,7 @@
 Token::Token()
 {}
 
-Token::Token(const std::string & type_, std::optional<std::variant<int, double, std::string>> value, std::optional<Position> posStart, std::optional<Position> posEnd)
+Token::Token(const std::string & type_, std::optional<std::variant<int64_t, double, std::string>> value, std::optional<Position> posStart, std::optional<Position> posEnd)
 {
 	type = type_;
 	this->value = value;
@@ -23,8 +23,8 @@ std::string Token::Repr()
 {
 	if (value.has_value())
 	{
-		if (std::holds_alternative<int>(value.value()))
-			return "INT:" + std::to_string(std::get<int>(value.value()));
+		if (std::holds_alternative<int64_t>(value.value()))
+			return "INT:" + std::to_string(std::get<int64_t>(value.value()));
 		else if (std::holds_alternative<double>(value.value()))
 			return "FLOAT:" + std::to_string(std::get<double>(value.value()));
 		else if (std::holds_alternative<std::string>(value.value()))
@@ -33,12 +33,12 @@ std::string Token::Repr()
 	return type;
 }
 
-bool Token::Matches(std::string type_, std::optional<std::variant<int, double, std::string>> value)
+bool Token::Matches(const std::string& type_, const std::optional<std::variant<int64_t, double, std::string>>& value) const
 {
 	return (type == type_) && (this->value == value);
 }
 
-std::variant<int, double, std::string> Token::GetValue() const
+const std::variant<int64_t, double, std::string>& Token::GetValue() const
 {
 	if (value.has_value())
 		return value.value();
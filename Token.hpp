@@ -5,6 +5,7 @@
 #include <variant>
 #include <string>
 #include <array>
+#include <cstdint>
 
 constexpr char TT_INT[]				= "INT";
 constexpr char TT_FLOAT[]			= "FLOAT";
@@ -31,8 +32,10 @@ constexpr char TT_COMMA[]			= "COMMA";
 constexpr char TT_AT[]				= "AT";
 constexpr char TT_ARROW[]			= "ARROW";
 constexpr char TT_NEWLINE[]			= "NEWLINE";
+constexpr char TT_LCURLYBRACKET[]	= "LCURLYBRACKET";
 constexpr char TT_RCURLYBRACKET[]	= "RCURLYBRACKET";
 constexpr char TT_HASH[]			= "HASH";
+constexpr char TT_COLON[]			= "COLON";
 constexpr char TT_DBLCOLON[]		= "DBLCONON";
 constexpr char TT_EOF[]				= "EOF";
 
@@ -40,7 +43,7 @@ constexpr char DIGITS[]				= "0123456789";
 constexpr char LETTERS[]			= "abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ";
 constexpr char LETTERS_DIGITS[]		= "abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789";
 
-const std::array<std::string, 18> KEYWORDS = {
+const std::array<std::string, 23> KEYWORDS = {
 	"VAR",
 	"AND",
 	"OR",
@@ -52,12 +55,17 @@ const std::array<std::string, 18> KEYWORDS = {
 	"FOR",
 	"TO",
 	"STEP",
+	"IN",
 	"WHILE",
 	"FUNC",
 	"RETURN",
+	"YIELD",
+	"SPAWN",
+	"AWAIT",
 	"CONTINUE",
 	"BREAK",
 	"IMPORT",
+	"LAZY",
 	"AS"
 };
 
@@ -65,21 +73,21 @@ class Token
 {
 public:
 	Token();
-	Token(const std::string& type_, std::optional<std::variant<int, double, std::string>> value = std::nullopt, std::optional<Position> posStart = std::nullopt, std::optional<Position> posEnd = std::nullopt);
+	Token(const std::string& type_, std::optional<std::variant<int64_t, double, std::string>> value = std::nullopt, std::optional<Position> posStart = std::nullopt, std::optional<Position> posEnd = std::nullopt);
 
 	std::string Repr();
 
-	bool Matches(std::string type_, std::optional<std::variant<int, double, std::string>> value);
+	bool Matches(const std::string& type_, const std::optional<std::variant<int64_t, double, std::string>>& value) const;
 
-	std::string GetType() { return type; }
-	Position GetPosStart() { return posStart.value(); }
-	Position GetPosEnd() { return posEnd.value(); }
+	const std::string& GetType() const { return type; }
+	const Position& GetPosStart() const { return posStart.value(); }
+	const Position& GetPosEnd() const { return posEnd.value(); }
 
-	std::variant<int, double, std::string> GetValue() const;
+	const std::variant<int64_t, double, std::string>& GetValue() const;
 
 private:
 	std::string type;
-	std::optional<std::variant<int, double, std::string>> value = std::nullopt;
+	std::optional<std::variant<int64_t, double, std::string>> value = std::nullopt;
 	std::optional<Position> posStart = std::nullopt;
 	std::optional<Position> posEnd = std::nullopt;
 };
\ No newline at end of file
@@ -0,0 +1,44 @@
+// Counts every operator new of the interpreter. It isn't part of the project: build the interpreter with this
+// file added to its sources and run a script such as tests/AllocationCount.epp. The count is printed when the
+// program exits, with the environment variable MAX_ALLOCATIONS set a larger count fails the run
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+
+static unsigned long long allocations = 0;
+
+void* operator new(std::size_t size)
+{
+    allocations++;
+    void* memory = std::malloc(size != 0 ? size : 1);
+    if (memory == nullptr)
+        throw std::bad_alloc();
+    return memory;
+}
+
+void operator delete(void* memory) noexcept
+{
+    std::free(memory);
+}
+
+void operator delete(void* memory, std::size_t) noexcept
+{
+    std::free(memory);
+}
+
+namespace
+{
+    struct Report
+    {
+        ~Report()
+        {
+            std::fprintf(stderr, "allocations: %llu\n", allocations);
+            const char* limit = std::getenv("MAX_ALLOCATIONS");
+            if (limit != nullptr && allocations > std::strtoull(limit, nullptr, 10))
+            {
+                std::fprintf(stderr, "more than %s allocations\n", limit);
+                std::_Exit(1);
+            }
+        }
+    } report;
+}